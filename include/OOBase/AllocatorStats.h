@@ -0,0 +1,219 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_ALLOCATOR_STATS_H_INCLUDED_
+#define OOBASE_ALLOCATOR_STATS_H_INCLUDED_
+
+#include "Memory.h"
+#include "Atomic.h"
+
+namespace OOBase
+{
+	/// A snapshot of an allocator's counters
+	struct AllocatorStats
+	{
+		/// histogram[i] counts requests of at most (16 << i) bytes, the last bucket counts everything bigger
+		static const size_t histogram_size = 16;
+
+		size_t live_bytes;
+		size_t peak_bytes;
+		size_t allocations;
+		size_t frees;
+		size_t failures;
+		size_t overflows;   ///< Requests a fixed buffer could not satisfy, and passed on to the heap
+		size_t histogram[histogram_size];
+
+		static size_t size_class(size_t bytes)
+		{
+			size_t c = 0;
+			while (c < histogram_size-1 && (size_t(16) << c) < bytes)
+				++c;
+			return c;
+		}
+	};
+
+	namespace detail
+	{
+		/// Allocation counters that may be updated by many threads at once
+		/**
+		 *  This is a plain struct so that a zero-initialized static instance is
+		 *  usable before any constructors have run.
+		 */
+		struct AllocatorCounters
+		{
+			size_t m_live;
+			size_t m_peak;
+			size_t m_allocations;
+			size_t m_frees;
+			size_t m_failures;
+			size_t m_overflows;
+			size_t m_histogram[AllocatorStats::histogram_size];
+
+			/// Count a request without tracking how long it lives
+			void requested(size_t bytes)
+			{
+				Atomic<size_t>::Increment(m_allocations);
+				Atomic<size_t>::Increment(m_histogram[AllocatorStats::size_class(bytes)]);
+			}
+
+			void allocated(size_t bytes)
+			{
+				requested(bytes);
+
+				size_t live = Atomic<size_t>::Add(m_live,bytes);
+
+				for (size_t peak = m_peak;peak < live;)
+				{
+					size_t prev = Atomic<size_t>::CompareAndSwap(m_peak,peak,live);
+					if (prev == peak)
+						break;
+					peak = prev;
+				}
+			}
+
+			void freed(size_t bytes)
+			{
+				Atomic<size_t>::Increment(m_frees);
+				Atomic<size_t>::Subtract(m_live,bytes);
+			}
+
+			void failed()
+			{
+				Atomic<size_t>::Increment(m_failures);
+			}
+
+			void overflowed()
+			{
+				Atomic<size_t>::Increment(m_overflows);
+			}
+
+			void snapshot(AllocatorStats& stats) const;
+			void reset();
+		};
+	}
+
+	/// A static allocator that counts everything passing through it to Allocator
+	/**
+	 *  Each block carries a small header recording its size, so live and peak
+	 *  bytes are exact.  The counters are shared by every user of the same
+	 *  Allocator type, and are always collected.
+	 */
+	template <typename Allocator = CrtAllocator>
+	class CountingAllocator : public AllocateNewStatic<CountingAllocator<Allocator> >
+	{
+	public:
+		static void* allocate(size_t bytes, size_t align = 16)
+		{
+			size_t offset = header_size(align);
+			char* p = static_cast<char*>(Allocator::allocate(offset + bytes,offset));
+			if (!p)
+			{
+				s_counters.failed();
+				return NULL;
+			}
+
+			p += offset;
+			header(p)[0] = offset;
+			header(p)[1] = bytes;
+			s_counters.allocated(bytes);
+			return p;
+		}
+
+		static void* reallocate(void* ptr, size_t bytes, size_t align = 16)
+		{
+			if (!ptr)
+				return allocate(bytes,align);
+
+			if (!bytes)
+			{
+				free(ptr);
+				return NULL;
+			}
+
+			// The header offset depends on the alignment, so move the block rather than reallocate it
+			size_t old_bytes = header(ptr)[1];
+			void* p = allocate(bytes,align);
+			if (p)
+			{
+				memcpy(p,ptr,old_bytes < bytes ? old_bytes : bytes);
+				free(ptr);
+			}
+			return p;
+		}
+
+		static void free(void* ptr)
+		{
+			if (ptr)
+			{
+				s_counters.freed(header(ptr)[1]);
+				Allocator::free(static_cast<char*>(ptr) - header(ptr)[0]);
+			}
+		}
+
+		static bool get_stats(AllocatorStats& stats)
+		{
+			s_counters.snapshot(stats);
+			return true;
+		}
+
+		static void reset_stats()
+		{
+			s_counters.reset();
+		}
+
+	private:
+		static detail::AllocatorCounters s_counters;
+
+		// The header holds the offset back to the real block, and the requested size
+		static size_t header_size(size_t align)
+		{
+			return (align > 2*sizeof(size_t) ? align : 2*sizeof(size_t));
+		}
+
+		static size_t* header(void* ptr)
+		{
+			return static_cast<size_t*>(ptr) - 2;
+		}
+	};
+
+	template <typename Allocator>
+	detail::AllocatorCounters CountingAllocator<Allocator>::s_counters;
+
+	/// An AllocatorInstance that counts everything passing through it to another AllocatorInstance
+	class CountingAllocatorInstance : public AllocatorInstance
+	{
+	public:
+		CountingAllocatorInstance(AllocatorInstance& allocator);
+
+		void* allocate(size_t bytes, size_t align);
+		void* reallocate(void* ptr, size_t bytes, size_t align);
+		void free(void* ptr);
+
+		bool get_stats(AllocatorStats& stats) const;
+		void reset_stats();
+
+	private:
+		AllocatorInstance&        m_allocator;
+		detail::AllocatorCounters m_counters;
+	};
+}
+
+#endif // OOBASE_ALLOCATOR_STATS_H_INCLUDED_
@@ -22,7 +22,7 @@
 #ifndef OOBASE_ARENA_ALLOCATOR_H_INCLUDED_
 #define OOBASE_ARENA_ALLOCATOR_H_INCLUDED_
 
-#include "Memory.h"
+#include "AllocatorStats.h"
 
 namespace OOBase
 {
@@ -36,8 +36,14 @@ namespace OOBase
 		void* reallocate(void* ptr, size_t bytes, size_t align);
 		void free(void* ptr);
 
+		bool get_stats(AllocatorStats& stats) const;
+
 	private:
 		void* m_mspace;
+
+#if defined(OOBASE_ALLOC_STATS)
+		detail::AllocatorCounters m_stats;
+#endif
 	};
 }
 
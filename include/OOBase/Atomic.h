@@ -24,19 +24,62 @@
 
 #include "Base.h"
 
+#include <string.h>
+
+#if defined(_MSC_VER) && !defined(__ATOMIC_RELAXED) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+
 namespace OOBase
 {
+	/// The orderings of C++11's std::memory_order
+	/**
+	 *  They are only hints on the out-of-line fallback, which is always sequentially consistent.
+	 */
+	enum memory_order
+	{
+		memory_order_relaxed,
+		memory_order_consume,
+		memory_order_acquire,
+		memory_order_release,
+		memory_order_acq_rel,
+		memory_order_seq_cst
+	};
+
+#if defined(_WIN64) || defined(__LP64__) || defined(_LP64)
+#define OOBASE_ATOMIC_DWORD_SIZE 16
+#else
+#define OOBASE_ATOMIC_DWORD_SIZE 8
+#endif
+
 	namespace detail
 	{
 		template <typename T, const size_t S>
 		struct AtomicImpl;
 
 		void atomic_memory_barrier();
+
+		/// Two words that can be compared and swapped as one
+		struct OOBASE_ALIGNED(OOBASE_ATOMIC_DWORD_SIZE) AtomicDWord
+		{
+			size_t m_lo;
+			size_t m_hi;
+		};
+
+		bool atomic_cas_dword_locked(AtomicDWord* val, AtomicDWord* expected, const AtomicDWord* desired);
 	}
 
+	/// An atomic integer or pointer
+	/**
+	 *  Every operation defaults to memory_order_seq_cst.  Add(), Subtract(), Increment() and
+	 *  Decrement() return the new value; CompareAndSwap(), Exchange() and the fetch_ functions
+	 *  return the old.
+	 */
 	template <typename T>
 	class Atomic
 	{
+		typedef detail::AtomicImpl<T,sizeof(T)> impl;
+
 	public:
 		Atomic() : m_val()
 		{}
@@ -44,7 +87,7 @@ namespace OOBase
 		Atomic(const T v) : m_val(v)
 		{}
 
-		Atomic(const Atomic& a) : m_val(a.m_val)
+		Atomic(const Atomic& a) : m_val(a.load())
 		{}
 
 		~Atomic()
@@ -53,40 +96,78 @@ namespace OOBase
 		Atomic& operator = (const Atomic& a)
 		{
 			if (&a != this)
-				detail::AtomicImpl<T,sizeof(T)>::Exchange(m_val,a.m_val);
+				impl::Exchange(m_val,a.load(),memory_order_seq_cst);
 			return *this;
 		}
 
-		static T Exchange(T& val, const T newVal)
+		static T Load(const T& val, memory_order order = memory_order_seq_cst)
 		{
-			return detail::AtomicImpl<T,sizeof(T)>::Exchange(val,newVal);
+			return impl::Load(val,order);
 		}
 
-		T Exchange(const T newVal)
+		T load(memory_order order = memory_order_seq_cst) const
 		{
-			return Exchange(m_val,newVal);
+			return impl::Load(m_val,order);
 		}
 
-		static T CompareAndSwap(T& val, const T oldVal, const T newVal)
+		static void Store(T& val, const T newVal, memory_order order = memory_order_seq_cst)
 		{
-			return detail::AtomicImpl<T,sizeof(T)>::CompareAndSwap(val,oldVal,newVal);
+			impl::Store(val,newVal,order);
 		}
 
-		T CompareAndSwap(const T oldVal, const T newVal)
+		void store(const T newVal, memory_order order = memory_order_seq_cst)
 		{
-			return CompareAndSwap(m_val,oldVal,newVal);
+			impl::Store(m_val,newVal,order);
 		}
 
-		operator T () const
+		static T Exchange(T& val, const T newVal, memory_order order = memory_order_seq_cst)
+		{
+			return impl::Exchange(val,newVal,order);
+		}
+
+		T Exchange(const T newVal, memory_order order = memory_order_seq_cst)
+		{
+			return impl::Exchange(m_val,newVal,order);
+		}
+
+		static T CompareAndSwap(T& val, const T oldVal, const T newVal, memory_order order = memory_order_seq_cst)
+		{
+			return impl::CompareAndSwap(val,oldVal,newVal,order);
+		}
+
+		T CompareAndSwap(const T oldVal, const T newVal, memory_order order = memory_order_seq_cst)
+		{
+			return impl::CompareAndSwap(m_val,oldVal,newVal,order);
+		}
+
+		static T FetchOr(T& val, const T bits, memory_order order = memory_order_seq_cst)
+		{
+			return impl::FetchOr(val,bits,order);
+		}
+
+		T fetch_or(const T bits, memory_order order = memory_order_seq_cst)
+		{
+			return impl::FetchOr(m_val,bits,order);
+		}
+
+		static T FetchAnd(T& val, const T bits, memory_order order = memory_order_seq_cst)
 		{
-			detail::atomic_memory_barrier();
+			return impl::FetchAnd(val,bits,order);
+		}
+
+		T fetch_and(const T bits, memory_order order = memory_order_seq_cst)
+		{
+			return impl::FetchAnd(m_val,bits,order);
+		}
 
-			return m_val;
+		operator T () const
+		{
+			return load();
 		}
 
-		static T Increment(T& val)
+		static T Increment(T& val, memory_order order = memory_order_seq_cst)
 		{
-			return detail::AtomicImpl<T,sizeof(T)>::Increment(val);
+			return impl::Increment(val,order);
 		}
 
 		T operator ++()
@@ -94,9 +175,9 @@ namespace OOBase
 			return Increment(m_val);
 		}
 
-		static T Decrement(T& val)
+		static T Decrement(T& val, memory_order order = memory_order_seq_cst)
 		{
-			return detail::AtomicImpl<T,sizeof(T)>::Decrement(val);
+			return impl::Decrement(val,order);
 		}
 
 		T operator --()
@@ -114,9 +195,9 @@ namespace OOBase
 			return Decrement(m_val) + 1;
 		}
 
-		static T Add(T& val, const T add)
+		static T Add(T& val, const T add, memory_order order = memory_order_seq_cst)
 		{
-			return detail::AtomicImpl<T,sizeof(T)>::Add(val,add);
+			return impl::Add(val,add,order);
 		}
 
 		Atomic& operator += (T val)
@@ -127,12 +208,12 @@ namespace OOBase
 
 		Atomic& operator += (const Atomic& rhs)
 		{
-			return *this += rhs.m_val;
+			return *this += rhs.load();
 		}
 
-		static T Subtract(T& val, const T subtract)
+		static T Subtract(T& val, const T subtract, memory_order order = memory_order_seq_cst)
 		{
-			return detail::AtomicImpl<T,sizeof(T)>::Subtract(val,subtract);
+			return impl::Subtract(val,subtract,order);
 		}
 
 		Atomic& operator -= (T val)
@@ -143,7 +224,7 @@ namespace OOBase
 
 		Atomic& operator -= (const Atomic& rhs)
 		{
-			return *this -= rhs.m_val;
+			return *this -= rhs.load();
 		}
 
 	private:
@@ -159,81 +240,533 @@ namespace OOBase
 		int32_t atomic_sub_4(int32_t volatile* val, const int32_t sub);
 		int32_t atomic_dec_4(int32_t volatile* val);
 
+		int64_t atomic_cas_8(int64_t volatile* val, const int64_t oldVal, const int64_t newVal);
+		int64_t atomic_swap_8(int64_t volatile* val, const int64_t newVal);
+		int64_t atomic_add_8(int64_t volatile* val, const int64_t add);
+		int64_t atomic_inc_8(int64_t volatile* val);
+		int64_t atomic_sub_8(int64_t volatile* val, const int64_t sub);
+		int64_t atomic_dec_8(int64_t volatile* val);
+
+		inline int32_t atomic_cas(int32_t volatile* val, const int32_t oldVal, const int32_t newVal)
+		{
+			return atomic_cas_4(val,oldVal,newVal);
+		}
+
+		inline int32_t atomic_swap(int32_t volatile* val, const int32_t newVal)
+		{
+			return atomic_swap_4(val,newVal);
+		}
+
+		inline int32_t atomic_add(int32_t volatile* val, const int32_t add)
+		{
+			return atomic_add_4(val,add);
+		}
+
+		inline int32_t atomic_inc(int32_t volatile* val)
+		{
+			return atomic_inc_4(val);
+		}
+
+		inline int32_t atomic_sub(int32_t volatile* val, const int32_t sub)
+		{
+			return atomic_sub_4(val,sub);
+		}
+
+		inline int32_t atomic_dec(int32_t volatile* val)
+		{
+			return atomic_dec_4(val);
+		}
+
+		inline int64_t atomic_cas(int64_t volatile* val, const int64_t oldVal, const int64_t newVal)
+		{
+			return atomic_cas_8(val,oldVal,newVal);
+		}
+
+		inline int64_t atomic_swap(int64_t volatile* val, const int64_t newVal)
+		{
+			return atomic_swap_8(val,newVal);
+		}
+
+		inline int64_t atomic_add(int64_t volatile* val, const int64_t add)
+		{
+			return atomic_add_8(val,add);
+		}
+
+		inline int64_t atomic_inc(int64_t volatile* val)
+		{
+			return atomic_inc_8(val);
+		}
+
+		inline int64_t atomic_sub(int64_t volatile* val, const int64_t sub)
+		{
+			return atomic_sub_8(val,sub);
+		}
+
+		inline int64_t atomic_dec(int64_t volatile* val)
+		{
+			return atomic_dec_8(val);
+		}
+
+		/// Out-of-line calls to src/Builtins.cpp, for compilers we cannot inline for
+		template <typename T, typename I>
+		struct AtomicCall
+		{
+			static T Load(const T& val, memory_order)
+			{
+				atomic_memory_barrier();
+				T v = *static_cast<const volatile T*>(&val);
+				atomic_memory_barrier();
+				return v;
+			}
+
+			static void Store(T& val, const T newVal, memory_order)
+			{
+				atomic_swap((I volatile*)(&val),(const I)newVal);
+			}
+
+			static T CompareAndSwap(T& val, const T oldVal, const T newVal, memory_order)
+			{
+				return (T)atomic_cas((I volatile*)(&val),(const I)oldVal,(const I)newVal);
+			}
+
+			static T Exchange(T& val, const T newVal, memory_order)
+			{
+				return (T)atomic_swap((I volatile*)(&val),(const I)newVal);
+			}
+
+			static T FetchOr(T& val, const T bits, memory_order order)
+			{
+				for (T oldVal = Load(val,order);;)
+				{
+					T prev = CompareAndSwap(val,oldVal,oldVal | bits,order);
+					if (prev == oldVal)
+						return prev;
+					oldVal = prev;
+				}
+			}
+
+			static T FetchAnd(T& val, const T bits, memory_order order)
+			{
+				for (T oldVal = Load(val,order);;)
+				{
+					T prev = CompareAndSwap(val,oldVal,oldVal & bits,order);
+					if (prev == oldVal)
+						return prev;
+					oldVal = prev;
+				}
+			}
+
+			static T Add(T& val, const T add, memory_order)
+			{
+				return (T)atomic_add((I volatile*)(&val),(const I)add);
+			}
+
+			static T Increment(T& val, memory_order)
+			{
+				return (T)atomic_inc((I volatile*)(&val));
+			}
+
+			static T Subtract(T& val, const T sub, memory_order)
+			{
+				return (T)atomic_sub((I volatile*)(&val),(const I)sub);
+			}
+
+			static T Decrement(T& val, memory_order)
+			{
+				return (T)atomic_dec((I volatile*)(&val));
+			}
+		};
+
+#if defined(__ATOMIC_RELAXED)
+		inline int atomic_order(memory_order order)
+		{
+			switch (order)
+			{
+			case memory_order_relaxed:
+				return __ATOMIC_RELAXED;
+			case memory_order_consume:
+				return __ATOMIC_CONSUME;
+			case memory_order_acquire:
+				return __ATOMIC_ACQUIRE;
+			case memory_order_release:
+				return __ATOMIC_RELEASE;
+			case memory_order_acq_rel:
+				return __ATOMIC_ACQ_REL;
+			default:
+				return __ATOMIC_SEQ_CST;
+			}
+		}
+
+		// A failed compare-and-swap only loads, so it may not release
+		inline int atomic_failure_order(memory_order order)
+		{
+			switch (order)
+			{
+			case memory_order_release:
+				return __ATOMIC_RELAXED;
+			case memory_order_acq_rel:
+				return __ATOMIC_ACQUIRE;
+			default:
+				return atomic_order(order);
+			}
+		}
+
+		/// The compiler's __atomic builtins, inlined for any order
 		template <typename T>
-		struct AtomicImpl<T,4>
+		struct AtomicBuiltin
 		{
-			static T CompareAndSwap(T& val, const T oldVal, const T newVal)
+			static T Load(const T& val, memory_order order)
+			{
+				return __atomic_load_n(&val,atomic_order(order));
+			}
+
+			static void Store(T& val, const T newVal, memory_order order)
 			{
-				return (T)atomic_cas_4((int32_t volatile*)(&val),(const int32_t)oldVal,(const int32_t)newVal);
+				__atomic_store_n(&val,newVal,atomic_order(order));
 			}
 
-			static T Exchange(T& val, const T newVal)
+			static T CompareAndSwap(T& val, T oldVal, const T newVal, memory_order order)
 			{
-				return (T)atomic_swap_4((int32_t volatile*)(&val),(const int32_t)newVal);
+				__atomic_compare_exchange_n(&val,&oldVal,newVal,false,atomic_order(order),atomic_failure_order(order));
+				return oldVal;
 			}
 
-			static T Add(T& val, const T add)
+			static T Exchange(T& val, const T newVal, memory_order order)
 			{
-				return (T)atomic_add_4((int32_t volatile*)(&val),(const int32_t)add);
+				return __atomic_exchange_n(&val,newVal,atomic_order(order));
 			}
 
-			static T Increment(T& val)
+			static T FetchOr(T& val, const T bits, memory_order order)
 			{
-				return (T)atomic_inc_4((int32_t volatile*)(&val));
+				return __atomic_fetch_or(&val,bits,atomic_order(order));
 			}
 
-			static T Subtract(T& val, const T sub)
+			static T FetchAnd(T& val, const T bits, memory_order order)
 			{
-				return (T)atomic_sub_4((int32_t volatile*)(&val),(const int32_t)sub);
+				return __atomic_fetch_and(&val,bits,atomic_order(order));
 			}
 
-			static T Decrement(T& val)
+			static T Add(T& val, const T add, memory_order order)
 			{
-				return (T)atomic_dec_4((int32_t volatile*)(&val));
+				return __atomic_add_fetch(&val,add,atomic_order(order));
+			}
+
+			static T Increment(T& val, memory_order order)
+			{
+				return __atomic_add_fetch(&val,1,atomic_order(order));
+			}
+
+			static T Subtract(T& val, const T sub, memory_order order)
+			{
+				return __atomic_sub_fetch(&val,sub,atomic_order(order));
+			}
+
+			static T Decrement(T& val, memory_order order)
+			{
+				return __atomic_sub_fetch(&val,1,atomic_order(order));
 			}
 		};
 
-		int64_t atomic_cas_8(int64_t volatile* val, const int64_t oldVal, const int64_t newVal);
-		int64_t atomic_swap_8(int64_t volatile* val, const int64_t newVal);
-		int64_t atomic_add_8(int64_t volatile* val, const int64_t add);
-		int64_t atomic_inc_8(int64_t volatile* val);
-		int64_t atomic_sub_8(int64_t volatile* val, const int64_t sub);
-		int64_t atomic_dec_8(int64_t volatile* val);
+		template <typename T>
+		struct AtomicImpl<T,4> : public AtomicBuiltin<T>
+		{};
+
+		template <typename T>
+		struct AtomicImpl<T,8> : public AtomicBuiltin<T>
+		{};
+
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+
+		// Every interlocked intrinsic is a full barrier, and aligned x86 loads and stores
+		// already have acquire and release semantics, so only the compiler needs fencing
+
+		template <typename T, typename I>
+		struct AtomicIntrinsic
+		{
+			static T Load(const T& val, memory_order)
+			{
+				T v = *static_cast<const volatile T*>(&val);
+				_ReadWriteBarrier();
+				return v;
+			}
+
+			static void Store(T& val, const T newVal, memory_order order)
+			{
+				if (order == memory_order_seq_cst)
+					I::Exchange(val,newVal,order);
+				else
+				{
+					_ReadWriteBarrier();
+					*static_cast<volatile T*>(&val) = newVal;
+				}
+			}
+
+			static T Increment(T& val, memory_order order)
+			{
+				return I::Add(val,(T)1,order);
+			}
+
+			static T Subtract(T& val, const T sub, memory_order order)
+			{
+				return I::Add(val,(T)(0 - sub),order);
+			}
+
+			static T Decrement(T& val, memory_order order)
+			{
+				return I::Add(val,(T)-1,order);
+			}
+		};
 
 		template <typename T>
-		struct AtomicImpl<T,8>
+		struct AtomicImpl<T,4> : public AtomicIntrinsic<T,AtomicImpl<T,4> >
 		{
-			static T CompareAndSwap(T& val, const T oldVal, const T newVal)
+			static T CompareAndSwap(T& val, const T oldVal, const T newVal, memory_order)
+			{
+				return (T)_InterlockedCompareExchange((long volatile*)(&val),(long)newVal,(long)oldVal);
+			}
+
+			static T Exchange(T& val, const T newVal, memory_order)
+			{
+				return (T)_InterlockedExchange((long volatile*)(&val),(long)newVal);
+			}
+
+			static T FetchOr(T& val, const T bits, memory_order)
+			{
+				return (T)_InterlockedOr((long volatile*)(&val),(long)bits);
+			}
+
+			static T FetchAnd(T& val, const T bits, memory_order)
 			{
-				return (T)atomic_cas_8((int64_t volatile*)(&val),(const int64_t)(oldVal),(const int64_t)newVal);
+				return (T)_InterlockedAnd((long volatile*)(&val),(long)bits);
 			}
 
-			static T Exchange(T& val, const T newVal)
+			static T Add(T& val, const T add, memory_order)
 			{
-				return (T)atomic_swap_8((int64_t volatile*)(&val),(const int64_t)newVal);
+				return (T)(_InterlockedExchangeAdd((long volatile*)(&val),(long)add) + (long)add);
 			}
+		};
 
-			static T Add(T& val, const T add)
+#if defined(_M_X64)
+		template <typename T>
+		struct AtomicImpl<T,8> : public AtomicIntrinsic<T,AtomicImpl<T,8> >
+		{
+			static T CompareAndSwap(T& val, const T oldVal, const T newVal, memory_order)
 			{
-				return (T)atomic_add_8((int64_t volatile*)(&val),(const int64_t)add);
+				return (T)_InterlockedCompareExchange64((__int64 volatile*)(&val),(__int64)newVal,(__int64)oldVal);
 			}
 
-			static T Increment(T& val)
+			static T Exchange(T& val, const T newVal, memory_order)
 			{
-				return (T)atomic_inc_8((int64_t volatile*)(&val));
+				return (T)_InterlockedExchange64((__int64 volatile*)(&val),(__int64)newVal);
 			}
 
-			static T Subtract(T& val, const T sub)
+			static T FetchOr(T& val, const T bits, memory_order)
 			{
-				return (T)atomic_sub_8((int64_t volatile*)(&val),(const int64_t)sub);
+				return (T)_InterlockedOr64((__int64 volatile*)(&val),(__int64)bits);
 			}
 
-			static T Decrement(T& val)
+			static T FetchAnd(T& val, const T bits, memory_order)
 			{
-				return (T)atomic_dec_8((int64_t volatile*)(&val));
+				return (T)_InterlockedAnd64((__int64 volatile*)(&val),(__int64)bits);
+			}
+
+			static T Add(T& val, const T add, memory_order)
+			{
+				return (T)(_InterlockedExchangeAdd64((__int64 volatile*)(&val),(__int64)add) + (__int64)add);
 			}
 		};
+#else
+		// 8-byte loads are not atomic on 32-bit x86
+		template <typename T>
+		struct AtomicImpl<T,8> : public AtomicCall<T,int64_t>
+		{};
+#endif
+
+#else
+		template <typename T>
+		struct AtomicImpl<T,4> : public AtomicCall<T,int32_t>
+		{};
+
+		template <typename T>
+		struct AtomicImpl<T,8> : public AtomicCall<T,int64_t>
+		{};
+#endif
+
+		/// A fence ordering the plain loads and stores either side of it, like std::atomic_thread_fence
+		inline void atomic_thread_fence(memory_order order)
+		{
+#if defined(__ATOMIC_RELAXED)
+			switch (order)
+			{
+			case memory_order_relaxed:
+				break;
+			case memory_order_consume:
+			case memory_order_acquire:
+				__atomic_thread_fence(__ATOMIC_ACQUIRE);
+				break;
+			case memory_order_release:
+				__atomic_thread_fence(__ATOMIC_RELEASE);
+				break;
+			case memory_order_acq_rel:
+				__atomic_thread_fence(__ATOMIC_ACQ_REL);
+				break;
+			default:
+				__atomic_thread_fence(__ATOMIC_SEQ_CST);
+				break;
+			}
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+			// x86 only reorders stores after loads, so anything short of seq_cst just stops the compiler
+			if (order == memory_order_seq_cst)
+				atomic_memory_barrier();
+			else if (order != memory_order_relaxed)
+				_ReadWriteBarrier();
+#else
+			if (order != memory_order_relaxed)
+				atomic_memory_barrier();
+#endif
+		}
+
+		/// Swap desired into val if it equals expected, otherwise load val into expected
+		inline bool atomic_cas_dword(AtomicDWord& val, AtomicDWord& expected, const AtomicDWord& desired)
+		{
+#if (OOBASE_ATOMIC_DWORD_SIZE == 8)
+			int64_t e, d;
+			memcpy(&e,&expected,sizeof(e));
+			memcpy(&d,&desired,sizeof(d));
+			int64_t prev = Atomic<int64_t>::CompareAndSwap(*reinterpret_cast<int64_t*>(&val),e,d);
+			if (prev == e)
+				return true;
+
+			memcpy(&expected,&prev,sizeof(prev));
+			return false;
+#elif defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+			unsigned __int128 e, d;
+			memcpy(&e,&expected,sizeof(e));
+			memcpy(&d,&desired,sizeof(d));
+			unsigned __int128 prev = __sync_val_compare_and_swap(reinterpret_cast<unsigned __int128*>(&val),e,d);
+			if (prev == e)
+				return true;
+
+			memcpy(&expected,&prev,sizeof(prev));
+			return false;
+#elif defined(__GNUC__) && defined(__x86_64__)
+			bool ret;
+			__asm__ __volatile__ (
+				"lock; cmpxchg16b %1\n\t"
+				"setz %0"
+				: "=q" (ret), "+m" (val), "+a" (expected.m_lo), "+d" (expected.m_hi)
+				: "b" (desired.m_lo), "c" (desired.m_hi)
+				: "cc", "memory");
+			return ret;
+#elif defined(_MSC_VER) && defined(_M_X64)
+			return _InterlockedCompareExchange128(reinterpret_cast<__int64 volatile*>(&val),(__int64)desired.m_hi,(__int64)desired.m_lo,reinterpret_cast<__int64*>(&expected)) != 0;
+#else
+			return atomic_cas_dword_locked(&val,&expected,&desired);
+#endif
+		}
 	}
+
+	/// A pointer and a tag that changes every time the pointer is swapped
+	/**
+	 *  A compare-and-swap on the pair fails if the pointer has been swapped out
+	 *  and back in again since it was read, which a plain pointer cannot detect
+	 *  (the ABA problem).  See Atomic<TaggedPtr<T> >.
+	 */
+	template <typename T>
+	class TaggedPtr
+	{
+		friend class Atomic<TaggedPtr<T> >;
+
+	public:
+		TaggedPtr(T* p = NULL, size_t tag = 0)
+		{
+			m_val.m_lo = reinterpret_cast<size_t>(p);
+			m_val.m_hi = tag;
+		}
+
+		T* get() const
+		{
+			return reinterpret_cast<T*>(m_val.m_lo);
+		}
+
+		size_t tag() const
+		{
+			return m_val.m_hi;
+		}
+
+		T* operator ->() const
+		{
+			return get();
+		}
+
+		/// The value to swap in to replace this one with p
+		TaggedPtr next(T* p) const
+		{
+			return TaggedPtr(p,m_val.m_hi + 1);
+		}
+
+		bool operator == (const TaggedPtr& rhs) const
+		{
+			return (m_val.m_lo == rhs.m_val.m_lo && m_val.m_hi == rhs.m_val.m_hi);
+		}
+
+		bool operator != (const TaggedPtr& rhs) const
+		{
+			return !(*this == rhs);
+		}
+
+	private:
+		detail::AtomicDWord m_val;
+	};
+
+	/// A TaggedPtr updated with a double-width compare-and-swap
+	/**
+	 *  This is cmpxchg16b on x86-64, a plain 8-byte compare-and-swap on 32-bit
+	 *  platforms, and a striped lock where the CPU has neither.  Every update is
+	 *  sequentially consistent.
+	 */
+	template <typename T>
+	class Atomic<TaggedPtr<T> > : public NonCopyable
+	{
+	public:
+		Atomic(T* p = NULL) : m_val(p)
+		{}
+
+		/// Each word is read atomically, but the pair may be torn, in which case the CompareAndSwap that follows fails
+		TaggedPtr<T> load() const
+		{
+			TaggedPtr<T> v;
+			v.m_val.m_hi = Atomic<size_t>::Load(m_val.m_val.m_hi,memory_order_acquire);
+			v.m_val.m_lo = Atomic<size_t>::Load(m_val.m_val.m_lo,memory_order_acquire);
+			return v;
+		}
+
+		void store(const TaggedPtr<T>& newVal)
+		{
+			for (TaggedPtr<T> oldVal = load();;)
+			{
+				TaggedPtr<T> prev = CompareAndSwap(oldVal,newVal);
+				if (prev == oldVal)
+					break;
+				oldVal = prev;
+			}
+		}
+
+		TaggedPtr<T> CompareAndSwap(const TaggedPtr<T>& oldVal, const TaggedPtr<T>& newVal)
+		{
+			TaggedPtr<T> prev(oldVal);
+			detail::atomic_cas_dword(m_val.m_val,prev.m_val,newVal.m_val);
+			return prev;
+		}
+
+		operator TaggedPtr<T> () const
+		{
+			return load();
+		}
+
+	private:
+		TaggedPtr<T> m_val;
+	};
 }
 
 #endif // OOBASE_ATOMIC_H_INCLUDED_
@@ -221,6 +221,19 @@ namespace OOBase
 #define OOBASE_FORMAT(f,a,b)
 #endif
 
+#if defined(_MSC_VER)
+#define OOBASE_ALIGNED(n) __declspec(align(n))
+#elif defined(__GNUC__)
+#define OOBASE_ALIGNED(n) __attribute__((aligned(n)))
+#else
+#define OOBASE_ALIGNED(n)
+#endif
+
+#if !defined(OOBASE_CACHE_LINE_SIZE)
+/// The assumed size of a cache line, used to pad apart independently contended data
+#define OOBASE_CACHE_LINE_SIZE 64
+#endif
+
 #if defined(_MSC_VER)
 #define HAVE__IS_POD 1
 #define HAVE__ALIGNOF 1
@@ -0,0 +1,468 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_COMPACT_HASHTABLE_H_INCLUDED_
+#define OOBASE_COMPACT_HASHTABLE_H_INCLUDED_
+
+#include "HashTable.h"
+
+namespace OOBase
+{
+	/// A hash table that keeps its entries in insertion order
+	/**
+	 *  The entries live densely in one array, in the order they were inserted,
+	 *  with their 32-bit hashes in a parallel array, and a separate open-addressed
+	 *  array of 32-bit indexes into them does the hashing.  Iteration walks the
+	 *  entries, so it costs time proportional to size() rather than capacity, and
+	 *  always visits entries oldest first.
+	 *
+	 *  The entry arrays are sized to exactly what the index can hold.  Removing
+	 *  an entry destroys its key and value at once, but leaves a hole until the
+	 *  next time the index is rebuilt squeezes the holes out.
+	 */
+	template <typename K, typename V, typename Allocator = CrtAllocator, typename H = OOBase::Hash<K> >
+	class CompactHashTable : public Allocating<Allocator>
+	{
+		typedef Allocating<Allocator> baseClass;
+
+	public:
+		typedef detail::IteratorImpl<CompactHashTable,Pair<K,V>,size_t> iterator;
+		friend class detail::IteratorImpl<CompactHashTable,Pair<K,V>,size_t>;
+		typedef detail::IteratorImpl<const CompactHashTable,const Pair<K,V>,size_t> const_iterator;
+		friend class detail::IteratorImpl<const CompactHashTable,const Pair<K,V>,size_t>;
+
+		CompactHashTable(const H& h = H()) : baseClass(), m_data(NULL), m_hashes(NULL), m_index(NULL), m_index_size(0), m_size(0), m_used(0), m_count(0), m_hash(h), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		{
+			iterator(this,size_t(-1)).swap(m_end);
+			const_iterator(this,size_t(-1)).swap(m_cend);
+		}
+
+		CompactHashTable(AllocatorInstance& allocator, const H& h = H()) : baseClass(allocator), m_data(NULL), m_hashes(NULL), m_index(NULL), m_index_size(0), m_size(0), m_used(0), m_count(0), m_hash(h), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		{
+			iterator(this,size_t(-1)).swap(m_end);
+			const_iterator(this,size_t(-1)).swap(m_cend);
+		}
+
+		CompactHashTable(const CompactHashTable& rhs) : baseClass(rhs), m_data(NULL), m_hashes(NULL), m_index(NULL), m_index_size(0), m_size(0), m_used(0), m_count(0), m_hash(rhs.m_hash), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		{
+			iterator(this,size_t(-1)).swap(m_end);
+			const_iterator(this,size_t(-1)).swap(m_cend);
+
+			if (rhs.m_count && !rebuild(rhs,rhs.m_count))
+				OOBase_CallCriticalFailure(system_error());
+		}
+
+		~CompactHashTable()
+		{
+			destroy_entries();
+			baseClass::free(m_data);
+			baseClass::free(m_index);
+		}
+
+		CompactHashTable& operator = (const CompactHashTable& rhs)
+		{
+			CompactHashTable(rhs).swap(*this);
+			return *this;
+		}
+
+		void swap(CompactHashTable& rhs)
+		{
+			baseClass::swap(rhs);
+			OOBase::swap(m_data,rhs.m_data);
+			OOBase::swap(m_hashes,rhs.m_hashes);
+			OOBase::swap(m_index,rhs.m_index);
+			OOBase::swap(m_index_size,rhs.m_index_size);
+			OOBase::swap(m_size,rhs.m_size);
+			OOBase::swap(m_used,rhs.m_used);
+			OOBase::swap(m_count,rhs.m_count);
+			OOBase::swap(m_hash,rhs.m_hash);
+		}
+
+		/// Insert key, replacing the value but keeping the place of an existing entry
+		iterator insert(typename call_traits<K>::param_type key, typename call_traits<V>::param_type value)
+		{
+			uint32_t h = hash_i(key);
+			size_t pos = find_i(key,h);
+			if (pos != size_t(-1))
+			{
+				m_data[pos].second = value;
+				return iterator(this,pos);
+			}
+
+			// m_size never passes m_used, so after this there is room in the entry arrays too
+			if (m_used >= max_used(m_index_size) && !rebuild(*this,m_count + 1))
+				return m_end;
+
+			pos = m_size;
+			::new (&m_data[pos]) Pair<K,V>(key,value);
+			m_hashes[pos] = h;
+			++m_size;
+
+			place(h,pos);
+			++m_count;
+
+			return iterator(this,pos);
+		}
+
+		iterator insert(const Pair<K,V>& item)
+		{
+			return insert(item.first,item.second);
+		}
+
+		/// Make room for count entries without rebuilding the index again
+		bool reserve(size_t count)
+		{
+			return (count <= max_used(m_index_size) || rebuild(*this,count));
+		}
+
+		template <typename K1>
+		bool exists(const K1& key) const
+		{
+			return (find_i(key,hash_i(key)) != size_t(-1));
+		}
+
+		template <typename K1>
+		const_iterator find(const K1& key) const
+		{
+			return const_iterator(this,find_i(key,hash_i(key)));
+		}
+
+		template <typename K1>
+		iterator find(const K1& key)
+		{
+			return iterator(this,find_i(key,hash_i(key)));
+		}
+
+		template <typename K1>
+		bool find(const K1& key, V& val) const
+		{
+			size_t pos = find_i(key,hash_i(key));
+			if (pos == size_t(-1))
+				return false;
+
+			val = m_data[pos].second;
+			return true;
+		}
+
+		iterator erase(iterator iter)
+		{
+			assert(iter.check(this));
+			size_t pos = iter.deref();
+
+			if (at(pos))
+			{
+				// Find the slot that points at pos, and leave a tombstone
+				for (size_t slot = m_hashes[pos] & (m_index_size-1);;slot = (slot + 1) & (m_index_size-1))
+				{
+					if (m_index[slot] == pos + 1)
+					{
+						m_index[slot] = s_deleted;
+						break;
+					}
+				}
+
+				m_data[pos].~Pair<K,V>();
+				m_hashes[pos] = 0;
+				--m_count;
+
+				// Holes at the end can go straight away
+				while (m_size && !m_hashes[m_size-1])
+					--m_size;
+			}
+
+			if (!at(pos))
+				next(pos);
+
+			return iterator(this,pos);
+		}
+
+		template <typename K1>
+		bool remove(const K1& key, V* value = NULL)
+		{
+			iterator i = find(key);
+			if (i == m_end)
+				return false;
+
+			if (value)
+				*value = i->second;
+
+			erase(i);
+			return true;
+		}
+
+		/// Remove the most recently inserted entry
+		bool pop(K* key = NULL, V* value = NULL)
+		{
+			iterator i = back();
+			if (i == m_end)
+				return false;
+
+			if (key)
+				*key = i->first;
+
+			if (value)
+				*value = i->second;
+
+			erase(i);
+			return true;
+		}
+
+		void clear()
+		{
+			destroy_entries();
+			if (m_index)
+				memset(m_index,0,(m_index_size + max_used(m_index_size)) * sizeof(uint32_t));
+			m_size = 0;
+			m_used = 0;
+			m_count = 0;
+		}
+
+		bool empty() const
+		{
+			return (m_count == 0);
+		}
+
+		size_t size() const
+		{
+			return m_count;
+		}
+
+		iterator begin()
+		{
+			return iterator(this,first());
+		}
+
+		const_iterator cbegin() const
+		{
+			return const_iterator(this,first());
+		}
+
+		const_iterator begin() const
+		{
+			return cbegin();
+		}
+
+		iterator back()
+		{
+			return iterator(this,m_size ? m_size-1 : size_t(-1));
+		}
+
+		const_iterator back() const
+		{
+			return const_iterator(this,m_size ? m_size-1 : size_t(-1));
+		}
+
+		iterator end()
+		{
+			return m_end;
+		}
+
+		const_iterator cend() const
+		{
+			return m_cend;
+		}
+
+		const_iterator end() const
+		{
+			return m_cend;
+		}
+
+	private:
+		// The entries, and their hashes: 0 marks a removed entry
+		Pair<K,V>* m_data;
+		uint32_t*  m_hashes;
+
+		// Each slot is 0 when empty, s_deleted for a tombstone, or the position in m_data + 1.
+		// The same allocation holds m_hashes, straight after the index.
+		uint32_t* m_index;
+		size_t    m_index_size;
+		size_t    m_size;
+		size_t    m_used;
+		size_t    m_count;
+		H         m_hash;
+
+		iterator m_end;
+		const_iterator m_cend;
+
+		static const uint32_t s_deleted = 0xFFFFFFFF;
+
+		// Keep at least a quarter of the index empty, it is only 4 bytes a slot
+		static size_t max_used(size_t slots)
+		{
+			return slots / 4 * 3;
+		}
+
+		template <typename K1>
+		uint32_t hash_i(const K1& key) const
+		{
+			// Only the low bits pick a slot, so the low 32 are all that is worth keeping
+			uint32_t h = static_cast<uint32_t>(m_hash.hash(key));
+
+			// Never use 0 as it marks a removed entry
+			if (!h)
+				h = 1;
+
+			return h;
+		}
+
+		template <typename K1>
+		size_t find_i(const K1& key, uint32_t h) const
+		{
+			if (m_count == 0)
+				return size_t(-1);
+
+			for (size_t slot = h & (m_index_size-1);m_index[slot];slot = (slot + 1) & (m_index_size-1))
+			{
+				if (m_index[slot] != s_deleted)
+				{
+					size_t pos = m_index[slot] - 1;
+					if (m_hashes[pos] == h && m_data[pos].first == key)
+						return pos;
+				}
+			}
+
+			return size_t(-1);
+		}
+
+		void place(uint32_t h, size_t pos)
+		{
+			// Tombstones are not reused, so m_used also bounds the holes in m_data
+			size_t slot = h & (m_index_size-1);
+			while (m_index[slot])
+				slot = (slot + 1) & (m_index_size-1);
+
+			m_index[slot] = static_cast<uint32_t>(pos + 1);
+			++m_used;
+		}
+
+		void destroy_entries()
+		{
+			for (size_t i=0;i<m_size;++i)
+			{
+				if (m_hashes[i])
+				{
+					m_data[i].~Pair<K,V>();
+					m_hashes[i] = 0;
+				}
+			}
+		}
+
+		// Copy the entries of src, without holes, into new arrays with room for count entries
+		bool rebuild(const CompactHashTable& src, size_t count)
+		{
+			size_t new_size = 16;
+			while (max_used(new_size) < count)
+				new_size *= 2;
+
+			// Check for overflow of the 32-bit indexes
+			size_t capacity = max_used(new_size);
+			if (capacity >= s_deleted - 1)
+				return false;
+
+			uint32_t* new_index = static_cast<uint32_t*>(baseClass::allocate((new_size + capacity) * sizeof(uint32_t),alignment_of<uint32_t>::value));
+			if (!new_index)
+				return false;
+
+			Pair<K,V>* new_data = static_cast<Pair<K,V>*>(baseClass::allocate(capacity * sizeof(Pair<K,V>),alignment_of<Pair<K,V> >::value));
+			if (!new_data)
+			{
+				baseClass::free(new_index);
+				return false;
+			}
+
+			memset(new_index,0,(new_size + capacity) * sizeof(uint32_t));
+			uint32_t* new_hashes = new_index + new_size;
+
+			size_t j = 0;
+			for (size_t i=0;i<src.m_size;++i)
+			{
+				if (src.m_hashes[i])
+				{
+					::new (&new_data[j]) Pair<K,V>(src.m_data[i]);
+					new_hashes[j++] = src.m_hashes[i];
+				}
+			}
+
+			destroy_entries();
+			baseClass::free(m_data);
+			baseClass::free(m_index);
+
+			m_data = new_data;
+			m_hashes = new_hashes;
+			m_index = new_index;
+			m_index_size = new_size;
+			m_size = j;
+			m_count = j;
+			m_used = 0;
+
+			for (size_t i=0;i<m_size;++i)
+				place(m_hashes[i],i);
+
+			return true;
+		}
+
+		Pair<K,V>* at(size_t pos)
+		{
+			return (pos < m_size && m_hashes[pos] ? &m_data[pos] : NULL);
+		}
+
+		const Pair<K,V>* at(size_t pos) const
+		{
+			return (pos < m_size && m_hashes[pos] ? &m_data[pos] : NULL);
+		}
+
+		size_t first() const
+		{
+			size_t pos = 0;
+			if (!at(pos))
+				next(pos);
+			return pos;
+		}
+
+		void next(size_t& pos) const
+		{
+			while (++pos < m_size && !m_hashes[pos])
+				;
+
+			if (pos >= m_size)
+				pos = size_t(-1);
+		}
+
+		void prev(size_t& pos) const
+		{
+			if (pos > m_size)
+				pos = m_size;
+
+			while (pos-- > 0 && !m_hashes[pos])
+				;
+		}
+
+		void iterator_move(size_t& pos, ptrdiff_t n) const
+		{
+			for (ptrdiff_t i = 0;i < n && pos < m_size;++i)
+				next(pos);
+			for (ptrdiff_t i = n;i < 0 && pos < m_size;++i)
+				prev(pos);
+		}
+	};
+}
+
+#endif // OOBASE_COMPACT_HASHTABLE_H_INCLUDED_
@@ -0,0 +1,195 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_CONCURRENT_HASHTABLE_H_INCLUDED_
+#define OOBASE_CONCURRENT_HASHTABLE_H_INCLUDED_
+
+#include "HashTable.h"
+#include "Mutex.h"
+
+namespace OOBase
+{
+	/// A HashTable that may be shared between threads
+	/**
+	 *  The keys are split between s_shards shards by hash, each a HashTable with
+	 *  its own FastMutex, padded to keep neighbouring shards off each other's cache
+	 *  lines.  Threads working on keys in different shards never contend.
+	 *
+	 *  Nothing hands out iterators or references, as they would outlive the lock:
+	 *  values are copied out, or changed in place by a functor called under the
+	 *  shard's lock.
+	 */
+	template <typename K, typename V, typename Allocator = CrtAllocator, typename H = OOBase::Hash<K> >
+	class ConcurrentHashTable : public NonCopyable
+	{
+		typedef HashTable<K,V,Allocator,H> table_t;
+
+	public:
+		static const size_t s_shard_bits = 5;
+		static const size_t s_shards = size_t(1) << s_shard_bits;
+
+		ConcurrentHashTable(const H& h = H()) : m_hash(h)
+		{
+			for (size_t i=0;i<s_shards;++i)
+				::new (m_shards[i].m_table) table_t(h);
+		}
+
+		ConcurrentHashTable(AllocatorInstance& allocator, const H& h = H()) : m_hash(h)
+		{
+			for (size_t i=0;i<s_shards;++i)
+				::new (m_shards[i].m_table) table_t(allocator,h);
+		}
+
+		~ConcurrentHashTable()
+		{
+			for (size_t i=0;i<s_shards;++i)
+				m_shards[i].table().~table_t();
+		}
+
+		/// Insert key, replacing any existing value, returns false only if out of memory
+		bool insert(typename call_traits<K>::param_type key, typename call_traits<V>::param_type value)
+		{
+			Shard& s = shard(key);
+			Guard<FastMutex> guard(s.m_lock);
+			return (s.table().insert(key,value) != s.table().end());
+		}
+
+		/// Call fn(value) on the existing value of key under the shard lock, or insert value if there is none
+		template <typename F>
+		bool update_or_insert(typename call_traits<K>::param_type key, typename call_traits<V>::param_type value, F fn)
+		{
+			Shard& s = shard(key);
+			Guard<FastMutex> guard(s.m_lock);
+
+			typename table_t::iterator i = s.table().find(key);
+			if (i != s.table().end())
+			{
+				fn(i->second);
+				return true;
+			}
+			return (s.table().insert(key,value) != s.table().end());
+		}
+
+		template <typename K1>
+		bool find(const K1& key, V& value) const
+		{
+			Shard& s = shard(key);
+			Guard<FastMutex> guard(s.m_lock);
+			return s.table().find(key,value);
+		}
+
+		template <typename K1>
+		bool exists(const K1& key) const
+		{
+			Shard& s = shard(key);
+			Guard<FastMutex> guard(s.m_lock);
+			return s.table().exists(key);
+		}
+
+		template <typename K1>
+		bool remove(const K1& key, V* value = NULL)
+		{
+			Shard& s = shard(key);
+			Guard<FastMutex> guard(s.m_lock);
+			return s.table().remove(key,value);
+		}
+
+		void clear()
+		{
+			for (size_t i=0;i<s_shards;++i)
+			{
+				Guard<FastMutex> guard(m_shards[i].m_lock);
+				m_shards[i].table().clear();
+			}
+		}
+
+		/// The total of every shard, which may be stale by the time it is returned
+		size_t size() const
+		{
+			size_t count = 0;
+			for (size_t i=0;i<s_shards;++i)
+			{
+				Guard<FastMutex> guard(m_shards[i].m_lock);
+				count += m_shards[i].table().size();
+			}
+			return count;
+		}
+
+		bool empty() const
+		{
+			return (size() == 0);
+		}
+
+		/// Call fn(key,value) for every entry, one shard at a time
+		/**
+		 *  Each shard is locked while it is visited, so every shard is seen in a
+		 *  consistent state, but not necessarily all at the same moment.  fn must not
+		 *  call back into this table.
+		 */
+		template <typename F>
+		F for_each(F fn)
+		{
+			for (size_t i=0;i<s_shards;++i)
+			{
+				Guard<FastMutex> guard(m_shards[i].m_lock);
+				for (typename table_t::iterator j = m_shards[i].table().begin();j != m_shards[i].table().end();++j)
+					fn(j->first,j->second);
+			}
+			return fn;
+		}
+
+	private:
+		struct OOBASE_ALIGNED(OOBASE_CACHE_LINE_SIZE) Shard
+		{
+			// Constructed in place so that it can be given an AllocatorInstance
+			union
+			{
+				char   m_table[sizeof(table_t)];
+				void*  m_align1;
+				double m_align2;
+			};
+			FastMutex m_lock;
+
+			table_t& table()
+			{
+				return *reinterpret_cast<table_t*>(m_table);
+			}
+		};
+
+		mutable Shard m_shards[s_shards];
+		H             m_hash;
+
+		template <typename K1>
+		Shard& shard(const K1& key) const
+		{
+			// Spread the hash with a Fibonacci multiply and take the top bits, the tables use the bottom ones
+			size_t h = m_hash.hash(key);
+#if defined(_WIN64) || defined(__LP64__) || defined(_LP64)
+			h *= size_t(0x9E3779B97F4A7C15ULL);
+#else
+			h *= size_t(0x9E3779B9);
+#endif
+			return m_shards[h >> (sizeof(size_t)*8 - s_shard_bits)];
+		}
+	};
+}
+
+#endif // OOBASE_CONCURRENT_HASHTABLE_H_INCLUDED_
@@ -46,12 +46,21 @@ namespace OOBase
 		~Condition();
 
 		bool wait(Condition::Mutex& mutex, const Timeout& timeout = OOBase::Timeout()) const;
+		bool wait(FastMutex& mutex, const Timeout& timeout = OOBase::Timeout()) const;
 		void signal();
 		void broadcast();
 
 		void swap(Condition& mutex);
 
 	private:
+		/** \var m_seq
+		 *  Bumped by every signal while there are FastMutex waiters, who sleep on it as a futex.
+		 */
+		mutable uint32_t m_seq;
+		mutable uint32_t m_fast_waiters;
+
+		void wake_fast(bool all);
+
 		/** \var m_var
 		 *  The platform specific condition variable.
 		 */
@@ -66,6 +75,10 @@ namespace OOBase
 #endif
 	};
 
+	/// A manual or auto-reset event, held in a single futex word
+	/**
+	 *  set() and wait() only enter the kernel when a thread actually has to sleep.
+	 */
 	class Event : public NonCopyable
 	{
 	public:
@@ -78,18 +91,60 @@ namespace OOBase
 		void reset();
 
 	private:
-		/** \var m_var
-		 *  The platform specific event variable.
-		 *  We use an OOBase::Condition for non Win32 platforms
-		 */
-#if defined(_WIN32)
-		Win32::SmartHandle m_handle;
-#else
-		Condition                m_condition;
-		mutable Condition::Mutex m_lock;
-		bool                     m_bAuto;
-		mutable bool             m_bSet;
-#endif
+		mutable uint32_t m_state;
+		mutable uint32_t m_waiters;
+		bool             m_bAuto;
+	};
+
+	/// A counting semaphore, usable with Guard<>
+	class Semaphore : public NonCopyable
+	{
+	public:
+		Semaphore(uint32_t count = 0);
+
+		bool try_acquire();
+		void acquire();
+		bool acquire(const Timeout& timeout);
+		void release(uint32_t count = 1);
+
+	private:
+		uint32_t m_count;
+		uint32_t m_waiters;
+	};
+
+	/// A single use countdown: wait() returns once count_down() has been called count times
+	class Latch : public NonCopyable
+	{
+	public:
+		Latch(uint32_t count);
+
+		void count_down(uint32_t n = 1);
+		bool is_ready() const;
+		bool wait(const Timeout& timeout = OOBase::Timeout()) const;
+
+	private:
+		mutable uint32_t m_count;
+		mutable uint32_t m_waiters;
+	};
+
+	/// A reusable rendezvous for a fixed number of threads
+	/**
+	 *  Each call to wait() blocks until count threads have called it, and then the
+	 *  barrier resets for the next phase.  A thread whose wait() times out withdraws
+	 *  from the phase, unless it completed meanwhile.  At most 65535 threads.
+	 */
+	class Barrier : public NonCopyable
+	{
+	public:
+		Barrier(uint32_t count);
+
+		bool wait(const Timeout& timeout = OOBase::Timeout());
+
+	private:
+		// The phase in the top 16 bits, threads arrived in this phase in the bottom 16
+		uint32_t       m_state;
+		uint32_t       m_waiters;
+		const uint32_t m_count;
 	};
 
 	template <typename T>
@@ -22,84 +22,122 @@
 #ifndef OOBASE_DELEGATE_H_INCLUDED_
 #define OOBASE_DELEGATE_H_INCLUDED_
 
-#include "SharedPtr.h"
+#include "Memory.h"
+
+#include <string.h>
 
 namespace OOBase
 {
+	namespace detail
+	{
+		namespace delegate
+		{
+			// Never defined, so a pointer to one of its members is as big as any can be
+			class Unknown;
+
+			/// The bound object and function, copied in and out as bytes so Delegates stay POD
+			struct Storage
+			{
+				void* m_obj;
+				char  m_fn[sizeof(void (Unknown::*)())];
+
+				bool operator == (const Storage& rhs) const
+				{
+					return m_obj == rhs.m_obj && memcmp(m_fn,rhs.m_fn,sizeof(m_fn)) == 0;
+				}
+
+#if defined(OOBASE_CDR_STREAM_H_INCLUDED_)
+				bool read(CDRStream& stream)
+				{
+					return (stream.read(m_obj) && stream.read_bytes(reinterpret_cast<uint8_t*>(m_fn),sizeof(m_fn)) == sizeof(m_fn));
+				}
+
+				bool write(CDRStream& stream) const
+				{
+					return (stream.write(m_obj) && stream.write_bytes(reinterpret_cast<const uint8_t*>(m_fn),sizeof(m_fn)));
+				}
+#endif
+			};
+		}
+	}
+
+	/// Delegates are plain values: binding and copying them never allocates
+	/**
+	 *  The Allocator parameter is no longer used, and is kept for source compatibility.
+	 */
 	template <typename R, typename Allocator = CrtAllocator>
 	class Delegate0 : public SafeBoolean
 	{
 	public:
-		Delegate0(R (*fn)() = NULL) : m_static(fn)
+		Delegate0(R (*fn)() = NULL) : m_thunk(fn ? &static_thunk : NULL)
 		{
+			memset(&m_data,0,sizeof(m_data));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		template<typename T>
-		Delegate0(T* p, R (T::*fn)()) : m_static(NULL)
+		Delegate0(T* p, R (T::*fn)()) : m_thunk(&member_thunk<T>)
 		{
-			m_ptr = OOBase::allocate_shared<Thunk<T>,Allocator>(p,fn);
+			static_assert(sizeof(fn) <= sizeof(m_data.m_fn),"Member function pointer too big");
+
+			memset(&m_data,0,sizeof(m_data));
+			m_data.m_obj = const_cast<void*>(static_cast<const void*>(p));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		bool operator == (const Delegate0& rhs) const
 		{
 			if (this == &rhs)
 				return true;
-			return m_ptr == rhs.m_ptr && m_static == rhs.m_static;
+			return m_thunk == rhs.m_thunk && m_data == rhs.m_data;
 		}
 
 		operator bool_type() const
 		{
-			return SafeBoolean::safe_bool(m_ptr || m_static != NULL);
+			return SafeBoolean::safe_bool(m_thunk != NULL);
 		}
 
 		R invoke() const
 		{
-			if (m_ptr)
-				return m_ptr->thunk();
-			return (*m_static)();
+			return (*m_thunk)(m_data);
 		}
 
 		void swap(Delegate0& rhs)
 		{
-			m_ptr.swap(rhs.m_ptr);
-			OOBase::swap(m_static,rhs.m_static);
+			OOBase::swap(m_thunk,rhs.m_thunk);
+			OOBase::swap(m_data,rhs.m_data);
 		}
 
 #if defined(OOBASE_CDR_STREAM_H_INCLUDED_)
 		bool read(CDRStream& stream)
 		{
-			return (m_ptr.read(stream) && stream.read(m_static));
+			return (stream.read(m_thunk) && m_data.read(stream));
 		}
 
 		bool write(CDRStream& stream) const
 		{
-			return (m_ptr.write(stream) && stream.write(m_static));
+			return (stream.write(m_thunk) && m_data.write(stream));
 		}
 #endif
 
 	private:
-		struct ThunkBase
+		R (*m_thunk)(const detail::delegate::Storage&);
+		detail::delegate::Storage m_data;
+
+		static R static_thunk(const detail::delegate::Storage& s)
 		{
-			virtual R thunk() = 0;
-		};
+			R (*fn)();
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (*fn)();
+		}
 
 		template<typename T>
-		struct Thunk : public ThunkBase
+		static R member_thunk(const detail::delegate::Storage& s)
 		{
-			Thunk(T* p, R (T::*fn)()) : m_p(p), m_fn(fn)
-			{}
-
-			R thunk()
-			{
-				return (m_p->*m_fn)();
-			}
-
-			T* m_p;
-			R (T::*m_fn)();
-		};
-
-		SharedPtr<ThunkBase> m_ptr;
-		R (*m_static)();
+			R (T::*fn)();
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (static_cast<T*>(s.m_obj)->*fn)();
+		}
 	};
 
 	template <typename Allocator, typename R>
@@ -130,76 +168,75 @@ namespace OOBase
 	class Delegate1 : public SafeBoolean
 	{
 	public:
-		Delegate1(R (*fn)(P1) = NULL) : m_static(fn)
+		Delegate1(R (*fn)(P1) = NULL) : m_thunk(fn ? &static_thunk : NULL)
 		{
+			memset(&m_data,0,sizeof(m_data));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		template<typename T>
-		Delegate1(T* p, R (T::*fn)(P1)) : m_static(NULL)
+		Delegate1(T* p, R (T::*fn)(P1)) : m_thunk(&member_thunk<T>)
 		{
-			m_ptr = OOBase::allocate_shared<Thunk<T>,Allocator>(p,fn);
+			static_assert(sizeof(fn) <= sizeof(m_data.m_fn),"Member function pointer too big");
+
+			memset(&m_data,0,sizeof(m_data));
+			m_data.m_obj = const_cast<void*>(static_cast<const void*>(p));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		bool operator == (const Delegate1& rhs) const
 		{
 			if (this == &rhs)
 				return true;
-			return m_ptr == rhs.m_ptr && m_static == rhs.m_static;
+			return m_thunk == rhs.m_thunk && m_data == rhs.m_data;
 		}
 
 		operator bool_type() const
 		{
-			return SafeBoolean::safe_bool(m_ptr || m_static != NULL);
+			return SafeBoolean::safe_bool(m_thunk != NULL);
 		}
 
 		R invoke(typename call_traits<P1>::param_type p1) const
 		{
-			if (m_ptr)
-				return m_ptr->thunk(p1);
-			return (*m_static)(p1);
+			return (*m_thunk)(m_data,p1);
 		}
 
 		void swap(Delegate1& rhs)
 		{
-			m_ptr.swap(rhs.m_ptr);
-			OOBase::swap(m_static,rhs.m_static);
+			OOBase::swap(m_thunk,rhs.m_thunk);
+			OOBase::swap(m_data,rhs.m_data);
 		}
 
 #if defined(OOBASE_CDR_STREAM_H_INCLUDED_)
 		bool read(CDRStream& stream)
 		{
-			return (m_ptr.read(stream) && stream.read(m_static));
+			return (stream.read(m_thunk) && m_data.read(stream));
 		}
 
 		bool write(CDRStream& stream) const
 		{
-			return (m_ptr.write(stream) && stream.write(m_static));
+			return (stream.write(m_thunk) && m_data.write(stream));
 		}
 #endif
 
 	private:
-		struct ThunkBase
+		R (*m_thunk)(const detail::delegate::Storage&, typename call_traits<P1>::param_type);
+		detail::delegate::Storage m_data;
+
+		static R static_thunk(const detail::delegate::Storage& s, typename call_traits<P1>::param_type p1)
 		{
-			virtual R thunk(typename call_traits<P1>::param_type) = 0;
-		};
+			R (*fn)(P1);
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (*fn)(p1);
+		}
 
 		template<typename T>
-		struct Thunk : public ThunkBase
+		static R member_thunk(const detail::delegate::Storage& s, typename call_traits<P1>::param_type p1)
 		{
-			Thunk(T* p, R (T::*fn)(P1)) : m_p(p), m_fn(fn)
-			{}
-
-			R thunk(typename call_traits<P1>::param_type p1)
-			{
-				return (m_p->*m_fn)(p1);
-			}
-
-			T* m_p;
-			R (T::*m_fn)(P1);
-		};
-
-		SharedPtr<ThunkBase> m_ptr;
-		R (*m_static)(P1);
+			R (T::*fn)(P1);
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (static_cast<T*>(s.m_obj)->*fn)(p1);
+		}
 	};
 
 	template <typename Allocator, typename R, typename P1>
@@ -230,76 +267,75 @@ namespace OOBase
 	class Delegate2 : public SafeBoolean
 	{
 	public:
-		Delegate2(R (*fn)(P1,P2) = NULL) : m_static(fn)
+		Delegate2(R (*fn)(P1,P2) = NULL) : m_thunk(fn ? &static_thunk : NULL)
 		{
+			memset(&m_data,0,sizeof(m_data));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		template<typename T>
-		Delegate2(T* p, R (T::*fn)(P1,P2)) : m_static(NULL)
+		Delegate2(T* p, R (T::*fn)(P1,P2)) : m_thunk(&member_thunk<T>)
 		{
-			m_ptr = OOBase::allocate_shared<Thunk<T>,Allocator>(p,fn);
+			static_assert(sizeof(fn) <= sizeof(m_data.m_fn),"Member function pointer too big");
+
+			memset(&m_data,0,sizeof(m_data));
+			m_data.m_obj = const_cast<void*>(static_cast<const void*>(p));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		bool operator == (const Delegate2& rhs) const
 		{
 			if (this == &rhs)
 				return true;
-			return m_ptr == rhs.m_ptr && m_static == rhs.m_static;
+			return m_thunk == rhs.m_thunk && m_data == rhs.m_data;
 		}
 
 		operator bool_type() const
 		{
-			return SafeBoolean::safe_bool(m_ptr || m_static != NULL);
+			return SafeBoolean::safe_bool(m_thunk != NULL);
 		}
 
 		R invoke(typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2) const
 		{
-			if (m_ptr)
-				return m_ptr->thunk(p1,p2);
-			return (*m_static)(p1,p2);
+			return (*m_thunk)(m_data,p1,p2);
 		}
 
 		void swap(Delegate2& rhs)
 		{
-			m_ptr.swap(rhs.m_ptr);
-			OOBase::swap(m_static,rhs.m_static);
+			OOBase::swap(m_thunk,rhs.m_thunk);
+			OOBase::swap(m_data,rhs.m_data);
 		}
 
 #if defined(OOBASE_CDR_STREAM_H_INCLUDED_)
 		bool read(CDRStream& stream)
 		{
-			return (m_ptr.read(stream) && stream.read(m_static));
+			return (stream.read(m_thunk) && m_data.read(stream));
 		}
 
 		bool write(CDRStream& stream) const
 		{
-			return (m_ptr.write(stream) && stream.write(m_static));
+			return (stream.write(m_thunk) && m_data.write(stream));
 		}
 #endif
 
 	private:
-		struct ThunkBase
+		R (*m_thunk)(const detail::delegate::Storage&, typename call_traits<P1>::param_type, typename call_traits<P2>::param_type);
+		detail::delegate::Storage m_data;
+
+		static R static_thunk(const detail::delegate::Storage& s, typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2)
 		{
-			virtual R thunk(typename call_traits<P1>::param_type, typename call_traits<P2>::param_type) = 0;
-		};
+			R (*fn)(P1,P2);
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (*fn)(p1,p2);
+		}
 
 		template<typename T>
-		struct Thunk : public ThunkBase
+		static R member_thunk(const detail::delegate::Storage& s, typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2)
 		{
-			Thunk(T* p, R (T::*fn)(P1,P2)) : m_p(p), m_fn(fn)
-			{}
-
-			R thunk(typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2)
-			{
-				return (m_p->*m_fn)(p1,p2);
-			}
-
-			T* m_p;
-			R (T::*m_fn)(P1,P2);
-		};
-
-		SharedPtr<ThunkBase> m_ptr;
-		R (*m_static)(P1,P2);
+			R (T::*fn)(P1,P2);
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (static_cast<T*>(s.m_obj)->*fn)(p1,p2);
+		}
 	};
 
 	template <typename Allocator, typename R, typename P1, typename P2>
@@ -330,76 +366,75 @@ namespace OOBase
 	class Delegate3 : public SafeBoolean
 	{
 	public:
-		Delegate3(R (*fn)(P1,P2,P3) = NULL) : m_static(fn)
+		Delegate3(R (*fn)(P1,P2,P3) = NULL) : m_thunk(fn ? &static_thunk : NULL)
 		{
+			memset(&m_data,0,sizeof(m_data));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		template<typename T>
-		Delegate3(T* p, R (T::*fn)(P1,P2,P3)) : m_static(NULL)
+		Delegate3(T* p, R (T::*fn)(P1,P2,P3)) : m_thunk(&member_thunk<T>)
 		{
-			m_ptr = OOBase::allocate_shared<Thunk<T>,Allocator>(p,fn);
+			static_assert(sizeof(fn) <= sizeof(m_data.m_fn),"Member function pointer too big");
+
+			memset(&m_data,0,sizeof(m_data));
+			m_data.m_obj = const_cast<void*>(static_cast<const void*>(p));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		bool operator == (const Delegate3& rhs) const
 		{
 			if (this == &rhs)
 				return true;
-			return m_ptr == rhs.m_ptr && m_static == rhs.m_static;
+			return m_thunk == rhs.m_thunk && m_data == rhs.m_data;
 		}
 
 		operator bool_type() const
 		{
-			return SafeBoolean::safe_bool(m_ptr || m_static != NULL);
+			return SafeBoolean::safe_bool(m_thunk != NULL);
 		}
 
 		R invoke(typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3) const
 		{
-			if (m_ptr)
-				return m_ptr->thunk(p1,p2,p3);
-			return (*m_static)(p1,p2,p3);
+			return (*m_thunk)(m_data,p1,p2,p3);
 		}
 
 		void swap(Delegate3& rhs)
 		{
-			m_ptr.swap(rhs.m_ptr);
-			OOBase::swap(m_static,rhs.m_static);
+			OOBase::swap(m_thunk,rhs.m_thunk);
+			OOBase::swap(m_data,rhs.m_data);
 		}
 
 #if defined(OOBASE_CDR_STREAM_H_INCLUDED_)
 		bool read(CDRStream& stream)
 		{
-			return (m_ptr.read(stream) && stream.read(m_static));
+			return (stream.read(m_thunk) && m_data.read(stream));
 		}
 
 		bool write(CDRStream& stream) const
 		{
-			return (m_ptr.write(stream) && stream.write(m_static));
+			return (stream.write(m_thunk) && m_data.write(stream));
 		}
 #endif
 
 	private:
-		struct ThunkBase
+		R (*m_thunk)(const detail::delegate::Storage&, typename call_traits<P1>::param_type, typename call_traits<P2>::param_type, typename call_traits<P3>::param_type);
+		detail::delegate::Storage m_data;
+
+		static R static_thunk(const detail::delegate::Storage& s, typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3)
 		{
-			virtual R thunk(typename call_traits<P1>::param_type, typename call_traits<P2>::param_type, typename call_traits<P3>::param_type) = 0;
-		};
+			R (*fn)(P1,P2,P3);
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (*fn)(p1,p2,p3);
+		}
 
 		template<typename T>
-		struct Thunk : public ThunkBase
+		static R member_thunk(const detail::delegate::Storage& s, typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3)
 		{
-			Thunk(T* p, R (T::*fn)(P1,P2,P3)) : m_p(p), m_fn(fn)
-			{}
-
-			R thunk(typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3)
-			{
-				return (m_p->*m_fn)(p1,p2,p3);
-			}
-
-			T* m_p;
-			R (T::*m_fn)(P1,P2,P3);
-		};
-
-		SharedPtr<ThunkBase> m_ptr;
-		R (*m_static)(P1,P2,P3);
+			R (T::*fn)(P1,P2,P3);
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (static_cast<T*>(s.m_obj)->*fn)(p1,p2,p3);
+		}
 	};
 
 	template <typename Allocator, typename R, typename P1, typename P2, typename P3>
@@ -430,76 +465,75 @@ namespace OOBase
 	class Delegate4 : public SafeBoolean
 	{
 	public:
-		Delegate4(R (*fn)(P1,P2,P3,P4) = NULL) : m_static(fn)
+		Delegate4(R (*fn)(P1,P2,P3,P4) = NULL) : m_thunk(fn ? &static_thunk : NULL)
 		{
+			memset(&m_data,0,sizeof(m_data));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		template<typename T>
-		Delegate4(T* p, R (T::*fn)(P1,P2,P3,P4)) : m_static(NULL)
+		Delegate4(T* p, R (T::*fn)(P1,P2,P3,P4)) : m_thunk(&member_thunk<T>)
 		{
-			m_ptr = OOBase::allocate_shared<Thunk<T>,Allocator>(p,fn);
+			static_assert(sizeof(fn) <= sizeof(m_data.m_fn),"Member function pointer too big");
+
+			memset(&m_data,0,sizeof(m_data));
+			m_data.m_obj = const_cast<void*>(static_cast<const void*>(p));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		bool operator == (const Delegate4& rhs) const
 		{
 			if (this == &rhs)
 				return true;
-			return m_ptr == rhs.m_ptr && m_static == rhs.m_static;
+			return m_thunk == rhs.m_thunk && m_data == rhs.m_data;
 		}
 
 		operator bool_type() const
 		{
-			return SafeBoolean::safe_bool(m_ptr || m_static != NULL);
+			return SafeBoolean::safe_bool(m_thunk != NULL);
 		}
 
 		R invoke(typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3, typename call_traits<P4>::param_type p4) const
 		{
-			if (m_ptr)
-				return m_ptr->thunk(p1,p2,p3,p4);
-			return (*m_static)(p1,p2,p3,p4);
+			return (*m_thunk)(m_data,p1,p2,p3,p4);
 		}
 
 		void swap(Delegate4& rhs)
 		{
-			m_ptr.swap(rhs.m_ptr);
-			OOBase::swap(m_static,rhs.m_static);
+			OOBase::swap(m_thunk,rhs.m_thunk);
+			OOBase::swap(m_data,rhs.m_data);
 		}
 
 #if defined(OOBASE_CDR_STREAM_H_INCLUDED_)
 		bool read(CDRStream& stream)
 		{
-			return (m_ptr.read(stream) && stream.read(m_static));
+			return (stream.read(m_thunk) && m_data.read(stream));
 		}
 
 		bool write(CDRStream& stream) const
 		{
-			return (m_ptr.write(stream) && stream.write(m_static));
+			return (stream.write(m_thunk) && m_data.write(stream));
 		}
 #endif
 
 	private:
-		struct ThunkBase
+		R (*m_thunk)(const detail::delegate::Storage&, typename call_traits<P1>::param_type, typename call_traits<P2>::param_type, typename call_traits<P3>::param_type, typename call_traits<P4>::param_type);
+		detail::delegate::Storage m_data;
+
+		static R static_thunk(const detail::delegate::Storage& s, typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3, typename call_traits<P4>::param_type p4)
 		{
-			virtual R thunk(typename call_traits<P1>::param_type, typename call_traits<P2>::param_type, typename call_traits<P3>::param_type, typename call_traits<P4>::param_type) = 0;
-		};
+			R (*fn)(P1,P2,P3,P4);
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (*fn)(p1,p2,p3,p4);
+		}
 
 		template<typename T>
-		struct Thunk : public ThunkBase
+		static R member_thunk(const detail::delegate::Storage& s, typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3, typename call_traits<P4>::param_type p4)
 		{
-			Thunk(T* p, R (T::*fn)(P1,P2,P3,P4)) : m_p(p), m_fn(fn)
-			{}
-
-			R thunk(typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3, typename call_traits<P4>::param_type p4)
-			{
-				return (m_p->*m_fn)(p1,p2,p3,p4);
-			}
-
-			T* m_p;
-			R (T::*m_fn)(P1,P2,P3,P4);
-		};
-
-		SharedPtr<ThunkBase> m_ptr;
-		R (*m_static)(P1,P2,P3,P4);
+			R (T::*fn)(P1,P2,P3,P4);
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (static_cast<T*>(s.m_obj)->*fn)(p1,p2,p3,p4);
+		}
 	};
 
 	template <typename Allocator, typename R, typename P1, typename P2, typename P3, typename P4>
@@ -530,76 +564,75 @@ namespace OOBase
 	class Delegate5 : public SafeBoolean
 	{
 	public:
-		Delegate5(R (*fn)(P1,P2,P3,P4,P5) = NULL) : m_static(fn)
+		Delegate5(R (*fn)(P1,P2,P3,P4,P5) = NULL) : m_thunk(fn ? &static_thunk : NULL)
 		{
+			memset(&m_data,0,sizeof(m_data));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		template<typename T>
-		Delegate5(T* p, R (T::*fn)(P1,P2,P3,P4,P5)) : m_static(NULL)
+		Delegate5(T* p, R (T::*fn)(P1,P2,P3,P4,P5)) : m_thunk(&member_thunk<T>)
 		{
-			m_ptr = OOBase::allocate_shared<Thunk<T>,Allocator>(p,fn);
+			static_assert(sizeof(fn) <= sizeof(m_data.m_fn),"Member function pointer too big");
+
+			memset(&m_data,0,sizeof(m_data));
+			m_data.m_obj = const_cast<void*>(static_cast<const void*>(p));
+			memcpy(m_data.m_fn,&fn,sizeof(fn));
 		}
 
 		bool operator == (const Delegate5& rhs) const
 		{
 			if (this == &rhs)
 				return true;
-			return m_ptr == rhs.m_ptr && m_static == rhs.m_static;
+			return m_thunk == rhs.m_thunk && m_data == rhs.m_data;
 		}
 
 		operator bool_type() const
 		{
-			return SafeBoolean::safe_bool(m_ptr || m_static != NULL);
+			return SafeBoolean::safe_bool(m_thunk != NULL);
 		}
 
 		R invoke(typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3, typename call_traits<P4>::param_type p4, typename call_traits<P5>::param_type p5) const
 		{
-			if (m_ptr)
-				return m_ptr->thunk(p1,p2,p3,p4,p5);
-			return (*m_static)(p1,p2,p3,p4,p5);
+			return (*m_thunk)(m_data,p1,p2,p3,p4,p5);
 		}
 
 		void swap(Delegate5& rhs)
 		{
-			m_ptr.swap(rhs.m_ptr);
-			OOBase::swap(m_static,rhs.m_static);
+			OOBase::swap(m_thunk,rhs.m_thunk);
+			OOBase::swap(m_data,rhs.m_data);
 		}
 
 #if defined(OOBASE_CDR_STREAM_H_INCLUDED_)
 		bool read(CDRStream& stream)
 		{
-			return (m_ptr.read(stream) && stream.read(m_static));
+			return (stream.read(m_thunk) && m_data.read(stream));
 		}
 
 		bool write(CDRStream& stream) const
 		{
-			return (m_ptr.write(stream) && stream.write(m_static));
+			return (stream.write(m_thunk) && m_data.write(stream));
 		}
 #endif
 
 	private:
-		struct ThunkBase
+		R (*m_thunk)(const detail::delegate::Storage&, typename call_traits<P1>::param_type, typename call_traits<P2>::param_type, typename call_traits<P3>::param_type, typename call_traits<P4>::param_type, typename call_traits<P5>::param_type);
+		detail::delegate::Storage m_data;
+
+		static R static_thunk(const detail::delegate::Storage& s, typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3, typename call_traits<P4>::param_type p4, typename call_traits<P5>::param_type p5)
 		{
-			virtual R thunk(typename call_traits<P1>::param_type, typename call_traits<P2>::param_type, typename call_traits<P3>::param_type, typename call_traits<P4>::param_type, typename call_traits<P5>::param_type) = 0;
-		};
+			R (*fn)(P1,P2,P3,P4,P5);
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (*fn)(p1,p2,p3,p4,p5);
+		}
 
 		template<typename T>
-		struct Thunk : public ThunkBase
+		static R member_thunk(const detail::delegate::Storage& s, typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3, typename call_traits<P4>::param_type p4, typename call_traits<P5>::param_type p5)
 		{
-			Thunk(T* p, R (T::*fn)(P1,P2,P3,P4,P5)) : m_p(p), m_fn(fn)
-			{}
-
-			R thunk(typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3, typename call_traits<P4>::param_type p4, typename call_traits<P5>::param_type p5)
-			{
-				return (m_p->*m_fn)(p1,p2,p3,p4,p5);
-			}
-
-			T* m_p;
-			R (T::*m_fn)(P1,P2,P3,P4,P5);
-		};
-
-		SharedPtr<ThunkBase> m_ptr;
-		R (*m_static)(P1,P2,P3,P4,P5);
+			R (T::*fn)(P1,P2,P3,P4,P5);
+			memcpy(&fn,s.m_fn,sizeof(fn));
+			return (static_cast<T*>(s.m_obj)->*fn)(p1,p2,p3,p4,p5);
+		}
 	};
 
 	template <typename Allocator, typename R, typename P1, typename P2, typename P3, typename P4, typename P5>
@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_EPOCH_H_INCLUDED_
+#define OOBASE_EPOCH_H_INCLUDED_
+
+#include "Memory.h"
+
+namespace OOBase
+{
+	namespace detail
+	{
+		namespace epoch
+		{
+			template <typename Allocator, typename T>
+			void destroy_static(void* ptr, void*)
+			{
+				Allocator::delete_free(static_cast<T*>(ptr));
+			}
+
+			template <typename T>
+			void destroy_instance(void* ptr, void* allocator)
+			{
+				static_cast<AllocatorInstance*>(allocator)->delete_free(static_cast<T*>(ptr));
+			}
+		}
+	}
+
+	/// Epoch-based reclamation of memory shared with lock-free readers
+	/**
+	 *  Readers bracket every access to shared nodes with enter() and exit(), or
+	 *  an EpochGuard.  A writer that unlinks a node passes it to retire(), and it
+	 *  is destroyed once every thread that could still be reading it has left
+	 *  its critical section.  Entering and leaving never block or wait.
+	 *
+	 *  Each thread registers itself on first use, and its TLS destructor hands
+	 *  anything it has not yet freed on to the other threads.
+	 */
+	namespace Epoch
+	{
+		/// Enter a read-side critical section, critical sections may nest
+		void enter();
+
+		/// Leave the critical section entered by the matching enter()
+		void exit();
+
+		/// Call destroy(ptr,param) once no reader can still be using ptr
+		void retire(void* ptr, void (*destroy)(void* ptr, void* param), void* param = NULL);
+
+		/// Retire ptr, to be destroyed with Allocator::delete_free()
+		template <typename Allocator, typename T>
+		void retire(T* ptr)
+		{
+			retire(ptr,&detail::epoch::destroy_static<Allocator,T>);
+		}
+
+		/// Retire ptr, to be destroyed with allocator.delete_free()
+		template <typename T>
+		void retire(T* ptr, AllocatorInstance& allocator)
+		{
+			retire(ptr,&detail::epoch::destroy_instance<T>,&allocator);
+		}
+
+		/// Try to move the epoch on, and destroy everything that is now safe
+		/**
+		 *  retire() calls this itself every so often, so it only needs to be
+		 *  called to hurry things along.
+		 */
+		void collect();
+	}
+
+	/// Holds a thread inside an Epoch critical section for its lifetime
+	class EpochGuard : public NonCopyable
+	{
+	public:
+		EpochGuard()
+		{
+			Epoch::enter();
+		}
+
+		~EpochGuard()
+		{
+			Epoch::exit();
+		}
+	};
+}
+
+#endif // OOBASE_EPOCH_H_INCLUDED_
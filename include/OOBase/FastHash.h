@@ -0,0 +1,191 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_FAST_HASH_H_INCLUDED_
+#define OOBASE_FAST_HASH_H_INCLUDED_
+
+#include "Base.h"
+
+#include <string.h>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace OOBase
+{
+	template <typename T>
+	struct Hash;
+
+	namespace detail
+	{
+		namespace FastHash
+		{
+			static const uint64_t s_p0 = 0xa0761d6478bd642fULL;
+			static const uint64_t s_p1 = 0xe7037ed1a0b428dbULL;
+
+			// Replace a and b with the low and high halves of their 128-bit product
+			inline void mul128(uint64_t& a, uint64_t& b)
+			{
+#if defined(__SIZEOF_INT128__)
+				unsigned __int128 r = a;
+				r *= b;
+				a = static_cast<uint64_t>(r);
+				b = static_cast<uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+				a = _umul128(a,b,&b);
+#else
+				uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+				uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+				uint64_t t = rl + (rm0 << 32);
+				uint64_t c = (t < rl ? 1 : 0);
+				uint64_t lo = t + (rm1 << 32);
+				c += (lo < t ? 1 : 0);
+				a = lo;
+				b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+			}
+
+			inline uint64_t mix(uint64_t a, uint64_t b)
+			{
+				mul128(a,b);
+				return a ^ b;
+			}
+
+			inline uint64_t read8(const unsigned char* p)
+			{
+				uint64_t v;
+				memcpy(&v,p,sizeof(v));
+				return v;
+			}
+
+			inline uint64_t read4(const unsigned char* p)
+			{
+				uint32_t v;
+				memcpy(&v,p,sizeof(v));
+				return v;
+			}
+
+			// 1 to 3 bytes, reading the first, middle and last
+			inline uint64_t read3(const unsigned char* p, size_t len)
+			{
+				return (uint64_t(p[0]) << 16) | (uint64_t(p[len >> 1]) << 8) | p[len - 1];
+			}
+		}
+
+		/// A 64-bit hash of len bytes, consuming 16 bytes per round in the manner of wyhash
+		inline uint64_t hash_bytes(const void* key, size_t len, uint64_t seed = 0)
+		{
+			using namespace FastHash;
+
+			const unsigned char* p = static_cast<const unsigned char*>(key);
+			seed ^= mix(seed ^ s_p0,s_p1);
+
+			uint64_t a = 0, b = 0;
+			if (len <= 16)
+			{
+				if (len >= 4)
+				{
+					// Two overlapping pairs of 4-byte reads cover anything from 4 to 16 bytes
+					size_t mid = (len >> 3) << 2;
+					a = (read4(p) << 32) | read4(p + mid);
+					b = (read4(p + len - 4) << 32) | read4(p + len - 4 - mid);
+				}
+				else if (len)
+					a = read3(p,len);
+			}
+			else
+			{
+				size_t i = len;
+				for (;i > 16;i -= 16,p += 16)
+					seed = mix(read8(p) ^ s_p1,read8(p + 8) ^ seed);
+
+				// The last 16 bytes, overlapping the final round if need be
+				a = read8(p + i - 16);
+				b = read8(p + i - 8);
+			}
+
+			a ^= s_p1;
+			b ^= seed;
+			mul128(a,b);
+			return mix(a ^ s_p0 ^ len,b ^ s_p1);
+		}
+
+		inline size_t fast_hash(const void* key, size_t len)
+		{
+			uint64_t h = hash_bytes(key,len);
+			if (sizeof(size_t) < sizeof(uint64_t))
+				h ^= (h >> 32);
+
+			size_t r = static_cast<size_t>(h);
+
+			// Never 0, so a cached hash can use 0 as 'not yet calculated'
+			return r ? r : 1;
+		}
+	}
+
+	/// A drop-in alternative to Hash<T> for the H parameter of the hash tables
+	/**
+	 *  Strings are hashed 8 bytes at a time, instead of FNV's one, and
+	 *  FastHash<SharedString<A> > uses the hash cached in the string itself.
+	 *  Other types are hashed as Hash<T>.
+	 */
+	template <typename T>
+	struct FastHash : public Hash<T>
+	{};
+
+	template <>
+	struct FastHash<char*>
+	{
+		static size_t hash(const char* c, size_t len = size_t(-1))
+		{
+			if (!c)
+				len = 0;
+			else if (len == size_t(-1))
+				len = strlen(c);
+
+			return detail::fast_hash(c,len);
+		}
+
+		template <typename S>
+		static size_t hash(const S& v)
+		{
+			return hash(v.c_str(),v.length());
+		}
+	};
+
+	template <>
+	struct FastHash<const char*>
+	{
+		static size_t hash(const char* c, size_t len = size_t(-1))
+		{
+			return FastHash<char*>::hash(c,len);
+		}
+
+		template <typename S>
+		static size_t hash(const S& v)
+		{
+			return hash(v.c_str(),v.length());
+		}
+	};
+}
+
+#endif // OOBASE_FAST_HASH_H_INCLUDED_
@@ -0,0 +1,574 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_FLAT_HASHTABLE_H_INCLUDED_
+#define OOBASE_FLAT_HASHTABLE_H_INCLUDED_
+
+#include "HashTable.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OOBASE_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace OOBase
+{
+	namespace detail
+	{
+		// Index of the lowest set bit, in Builtins.cpp
+		unsigned int ffs(uint16_t v);
+
+		namespace FlatHashTable
+		{
+			/// Index of the lowest set bit of a non-zero mask, kept inline for the probe loops
+			inline unsigned int lowest_bit(uint16_t v)
+			{
+				assert(v != 0);
+
+#if defined(__GNUC__)
+				return static_cast<unsigned int>(__builtin_ctz(v));
+#elif defined(_MSC_VER)
+				unsigned long i = 0;
+				_BitScanForward(&i,v);
+				return static_cast<unsigned int>(i);
+#else
+				return detail::ffs(v);
+#endif
+			}
+
+			// Control byte values: full slots hold the low 7 bits of their hash
+			static const int8_t s_empty = -128;
+			static const int8_t s_deleted = -2;
+
+			static const size_t s_group_size = 16;
+
+			inline bool is_full(int8_t c)
+			{
+				return c >= 0;
+			}
+
+			/// 16 control bytes, compared all at once
+			class Group
+			{
+			public:
+				Group(const int8_t* ctrl)
+				{
+#if defined(OOBASE_HAVE_SSE2)
+					m_ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+					m_ctrl = ctrl;
+#endif
+				}
+
+				/// A bit for each slot whose control byte equals h2
+				uint16_t match(int8_t h2) const
+				{
+#if defined(OOBASE_HAVE_SSE2)
+					return static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2),m_ctrl)));
+#else
+					uint16_t r = 0;
+					for (size_t i=0;i<s_group_size;++i)
+					{
+						if (m_ctrl[i] == h2)
+							r |= uint16_t(1) << i;
+					}
+					return r;
+#endif
+				}
+
+				uint16_t match_empty() const
+				{
+					return match(s_empty);
+				}
+
+				uint16_t match_empty_or_deleted() const
+				{
+#if defined(OOBASE_HAVE_SSE2)
+					// Empty and deleted are the only values less than -1
+					return static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1),m_ctrl)));
+#else
+					uint16_t r = 0;
+					for (size_t i=0;i<s_group_size;++i)
+					{
+						if (m_ctrl[i] < -1)
+							r |= uint16_t(1) << i;
+					}
+					return r;
+#endif
+				}
+
+			private:
+#if defined(OOBASE_HAVE_SSE2)
+				__m128i m_ctrl;
+#else
+				const int8_t* m_ctrl;
+#endif
+			};
+
+			inline unsigned int leading_zeros(uint16_t v)
+			{
+				unsigned int n = 0;
+				for (uint16_t bit = 0x8000;bit && !(v & bit);bit >>= 1)
+					++n;
+				return n;
+			}
+
+			/// Spread the bits of weak hashes, such as Hash<int>, so both halves are useful
+			inline size_t mix(size_t h)
+			{
+				h ^= h >> (sizeof(size_t)*4);
+				h *= size_t(0x9E3779B97F4A7C15ULL);
+				return h ^ (h >> (sizeof(size_t)*4));
+			}
+		}
+	}
+
+	/// An open addressing hash table with a separate array of control bytes
+	/**
+	 *  Each slot has one control byte holding 7 bits of its hash, or an empty
+	 *  or deleted marker.  Lookups scan the control bytes 16 at a time, with
+	 *  SSE2 where available, and only touch the slots whose bytes match, so
+	 *  most misses never read the slot array at all.
+	 *
+	 *  The interface follows HashTable, and insert() replaces any existing value.
+	 */
+	template <typename K, typename V, typename Allocator = CrtAllocator, typename H = OOBase::Hash<K> >
+	class FlatHashTable : public Allocating<Allocator>
+	{
+		typedef Allocating<Allocator> baseClass;
+
+	public:
+		typedef detail::IteratorImpl<FlatHashTable,Pair<K,V>,size_t> iterator;
+		friend class detail::IteratorImpl<FlatHashTable,Pair<K,V>,size_t>;
+		typedef detail::IteratorImpl<const FlatHashTable,const Pair<K,V>,size_t> const_iterator;
+		friend class detail::IteratorImpl<const FlatHashTable,const Pair<K,V>,size_t>;
+
+		FlatHashTable(const H& h = H()) : baseClass(), m_slots(NULL), m_ctrl(NULL), m_size(0), m_count(0), m_growth_left(0), m_hash(h), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		{
+			iterator(this,size_t(-1)).swap(m_end);
+			const_iterator(this,size_t(-1)).swap(m_cend);
+		}
+
+		FlatHashTable(AllocatorInstance& allocator, const H& h = H()) : baseClass(allocator), m_slots(NULL), m_ctrl(NULL), m_size(0), m_count(0), m_growth_left(0), m_hash(h), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		{
+			iterator(this,size_t(-1)).swap(m_end);
+			const_iterator(this,size_t(-1)).swap(m_cend);
+		}
+
+		FlatHashTable(const FlatHashTable& rhs) : baseClass(rhs), m_slots(NULL), m_ctrl(NULL), m_size(0), m_count(0), m_growth_left(0), m_hash(rhs.m_hash), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		{
+			iterator(this,size_t(-1)).swap(m_end);
+			const_iterator(this,size_t(-1)).swap(m_cend);
+
+			for (size_t i=0;i<rhs.m_size;++i)
+			{
+				if (detail::FlatHashTable::is_full(rhs.m_ctrl[i]) && !insert(rhs.m_slots[i]))
+					break;
+			}
+		}
+
+		~FlatHashTable()
+		{
+			destroy_all();
+			baseClass::free(m_slots);
+		}
+
+		FlatHashTable& operator = (const FlatHashTable& rhs)
+		{
+			FlatHashTable(rhs).swap(*this);
+			return *this;
+		}
+
+		void swap(FlatHashTable& rhs)
+		{
+			baseClass::swap(rhs);
+			OOBase::swap(m_slots,rhs.m_slots);
+			OOBase::swap(m_ctrl,rhs.m_ctrl);
+			OOBase::swap(m_size,rhs.m_size);
+			OOBase::swap(m_count,rhs.m_count);
+			OOBase::swap(m_growth_left,rhs.m_growth_left);
+			OOBase::swap(m_hash,rhs.m_hash);
+		}
+
+		iterator insert(typename call_traits<K>::param_type key, typename call_traits<V>::param_type value)
+		{
+			size_t h = hash_i(key);
+			size_t pos = find_i(key,h);
+			if (pos != size_t(-1))
+			{
+				m_slots[pos].second = value;
+				return iterator(this,pos);
+			}
+
+			pos = prepare_insert(h);
+			if (pos == size_t(-1))
+				return m_end;
+
+			::new (&m_slots[pos]) Pair<K,V>(key,value);
+			return iterator(this,pos);
+		}
+
+		iterator insert(const Pair<K,V>& item)
+		{
+			return insert(item.first,item.second);
+		}
+
+		template <typename K1>
+		bool exists(const K1& key) const
+		{
+			return (find_i(key,hash_i(key)) != size_t(-1));
+		}
+
+		template <typename K1>
+		const_iterator find(const K1& key) const
+		{
+			return const_iterator(this,find_i(key,hash_i(key)));
+		}
+
+		template <typename K1>
+		iterator find(const K1& key)
+		{
+			return iterator(this,find_i(key,hash_i(key)));
+		}
+
+		template <typename K1>
+		bool find(const K1& key, V& val) const
+		{
+			size_t pos = find_i(key,hash_i(key));
+			if (pos == size_t(-1))
+				return false;
+
+			val = m_slots[pos].second;
+			return true;
+		}
+
+		iterator erase(iterator iter)
+		{
+			assert(iter.check(this));
+			size_t pos = iter.deref();
+
+			if (pos < m_size && detail::FlatHashTable::is_full(m_ctrl[pos]))
+			{
+				m_slots[pos].~Pair<K,V>();
+				--m_count;
+
+				// If no probe sequence can have passed over this slot without meeting an empty one, it can be empty again
+				size_t before = (pos - detail::FlatHashTable::s_group_size) & (m_size-1);
+				uint16_t empty_after = detail::FlatHashTable::Group(m_ctrl + pos).match_empty();
+				uint16_t empty_before = detail::FlatHashTable::Group(m_ctrl + before).match_empty();
+				if (empty_before && empty_after && detail::FlatHashTable::lowest_bit(empty_after) + detail::FlatHashTable::leading_zeros(empty_before) < detail::FlatHashTable::s_group_size)
+				{
+					set_ctrl(pos,detail::FlatHashTable::s_empty);
+					++m_growth_left;
+				}
+				else
+					set_ctrl(pos,detail::FlatHashTable::s_deleted);
+			}
+
+			next(pos);
+			return iterator(this,pos);
+		}
+
+		template <typename K1>
+		bool remove(const K1& key, V* value = NULL)
+		{
+			iterator i = find(key);
+			if (i == m_end)
+				return false;
+
+			if (value)
+				*value = i->second;
+
+			erase(i);
+			return true;
+		}
+
+		bool pop(K* key = NULL, V* value = NULL)
+		{
+			iterator i = begin();
+			if (i == m_end)
+				return false;
+
+			if (key)
+				*key = i->first;
+
+			if (value)
+				*value = i->second;
+
+			erase(i);
+			return true;
+		}
+
+		void clear()
+		{
+			destroy_all();
+			reset_ctrl();
+		}
+
+		bool empty() const
+		{
+			return (m_count == 0);
+		}
+
+		size_t size() const
+		{
+			return m_count;
+		}
+
+		iterator begin()
+		{
+			size_t pos = size_t(-1);
+			next(pos);
+			return iterator(this,pos);
+		}
+
+		const_iterator cbegin() const
+		{
+			size_t pos = size_t(-1);
+			next(pos);
+			return const_iterator(this,pos);
+		}
+
+		const_iterator begin() const
+		{
+			return cbegin();
+		}
+
+		iterator end()
+		{
+			return m_end;
+		}
+
+		const_iterator cend() const
+		{
+			return m_cend;
+		}
+
+		const_iterator end() const
+		{
+			return m_cend;
+		}
+
+	private:
+		Pair<K,V>* m_slots;
+		int8_t*    m_ctrl;
+		size_t     m_size;
+		size_t     m_count;
+		size_t     m_growth_left;
+		H          m_hash;
+
+		iterator m_end;
+		const_iterator m_cend;
+
+		template <typename K1>
+		size_t hash_i(const K1& key) const
+		{
+			return detail::FlatHashTable::mix(m_hash.hash(key));
+		}
+
+		static int8_t h2(size_t h)
+		{
+			return static_cast<int8_t>(h & 0x7F);
+		}
+
+		static size_t max_load(size_t size)
+		{
+			// Keep at least 1/8 of the slots empty
+			return size - size/8;
+		}
+
+		void set_ctrl(size_t pos, int8_t c)
+		{
+			m_ctrl[pos] = c;
+
+			// The first group is mirrored past the end, so a group can be read from any position
+			if (pos < detail::FlatHashTable::s_group_size)
+				m_ctrl[m_size + pos] = c;
+		}
+
+		template <typename K1>
+		size_t find_i(const K1& key, size_t h) const
+		{
+			if (m_count == 0)
+				return size_t(-1);
+
+			int8_t c = h2(h);
+			size_t pos = (h >> 7) & (m_size-1);
+			for (size_t step = detail::FlatHashTable::s_group_size;;step += detail::FlatHashTable::s_group_size)
+			{
+				detail::FlatHashTable::Group g(m_ctrl + pos);
+				for (uint16_t m = g.match(c);m;m &= m - 1)
+				{
+					size_t i = (pos + detail::FlatHashTable::lowest_bit(m)) & (m_size-1);
+					if (m_slots[i].first == key)
+						return i;
+				}
+
+				if (g.match_empty())
+					return size_t(-1);
+
+				pos = (pos + step) & (m_size-1);
+			}
+		}
+
+		size_t find_non_full(size_t h) const
+		{
+			size_t pos = (h >> 7) & (m_size-1);
+			for (size_t step = detail::FlatHashTable::s_group_size;;step += detail::FlatHashTable::s_group_size)
+			{
+				uint16_t m = detail::FlatHashTable::Group(m_ctrl + pos).match_empty_or_deleted();
+				if (m)
+					return (pos + detail::FlatHashTable::lowest_bit(m)) & (m_size-1);
+
+				pos = (pos + step) & (m_size-1);
+			}
+		}
+
+		size_t prepare_insert(size_t h)
+		{
+			size_t pos = size_t(-1);
+			if (m_size)
+				pos = find_non_full(h);
+
+			// Reusing a deleted slot does not use up any of the empty ones
+			if (pos == size_t(-1) || (m_growth_left == 0 && m_ctrl[pos] == detail::FlatHashTable::s_empty))
+			{
+				// If at least half the headroom is tombstones, rehashing at the same size will do
+				size_t new_size = m_size * 2;
+				if (m_size == 0)
+					new_size = detail::FlatHashTable::s_group_size;
+				else if (m_count < max_load(m_size) / 2)
+					new_size = m_size;
+
+				if (!rehash(new_size))
+					return size_t(-1);
+
+				pos = find_non_full(h);
+			}
+
+			if (m_ctrl[pos] == detail::FlatHashTable::s_empty)
+				--m_growth_left;
+
+			set_ctrl(pos,h2(h));
+			++m_count;
+			return pos;
+		}
+
+		bool rehash(size_t new_size)
+		{
+			// The slots and the control bytes share one allocation, slots first
+			size_t ctrl_offset = new_size * sizeof(Pair<K,V>);
+			void* p = baseClass::allocate(ctrl_offset + new_size + detail::FlatHashTable::s_group_size,alignment_of<Pair<K,V> >::value);
+			if (!p)
+				return false;
+
+			Pair<K,V>* old_slots = m_slots;
+			int8_t* old_ctrl = m_ctrl;
+			size_t old_size = m_size;
+
+			m_slots = static_cast<Pair<K,V>*>(p);
+			m_ctrl = static_cast<int8_t*>(p) + ctrl_offset;
+			m_size = new_size;
+			reset_ctrl();
+
+			for (size_t i=0;i<old_size;++i)
+			{
+				if (detail::FlatHashTable::is_full(old_ctrl[i]))
+				{
+					size_t h = hash_i(old_slots[i].first);
+					size_t pos = find_non_full(h);
+					set_ctrl(pos,h2(h));
+					--m_growth_left;
+					++m_count;
+
+					::new (&m_slots[pos]) Pair<K,V>(old_slots[i]);
+					old_slots[i].~Pair<K,V>();
+				}
+			}
+
+			baseClass::free(old_slots);
+			return true;
+		}
+
+		void reset_ctrl()
+		{
+			if (m_ctrl)
+				memset(m_ctrl,detail::FlatHashTable::s_empty,m_size + detail::FlatHashTable::s_group_size);
+
+			m_count = 0;
+			m_growth_left = max_load(m_size);
+		}
+
+		void destroy_all()
+		{
+			for (size_t i=0;i<m_size && m_count;++i)
+			{
+				if (detail::FlatHashTable::is_full(m_ctrl[i]))
+				{
+					m_slots[i].~Pair<K,V>();
+					--m_count;
+				}
+			}
+		}
+
+		Pair<K,V>* at(size_t pos)
+		{
+			return (pos < m_size && detail::FlatHashTable::is_full(m_ctrl[pos]) ? &m_slots[pos] : NULL);
+		}
+
+		const Pair<K,V>* at(size_t pos) const
+		{
+			return (pos < m_size && detail::FlatHashTable::is_full(m_ctrl[pos]) ? &m_slots[pos] : NULL);
+		}
+
+		void next(size_t& pos) const
+		{
+			while (++pos < m_size && !detail::FlatHashTable::is_full(m_ctrl[pos]))
+				;
+
+			if (pos >= m_size)
+				pos = size_t(-1);
+		}
+
+		void prev(size_t& pos) const
+		{
+			if (pos > m_size)
+				pos = m_size;
+
+			while (pos-- > 0 && !detail::FlatHashTable::is_full(m_ctrl[pos]))
+				;
+		}
+
+		void iterator_move(size_t& pos, ptrdiff_t n) const
+		{
+			for (ptrdiff_t i = 0;i < n && pos < m_size;++i)
+				next(pos);
+			for (ptrdiff_t i = n;i < 0 && pos < m_size;++i)
+				prev(pos);
+		}
+	};
+}
+
+#endif // OOBASE_FLAT_HASHTABLE_H_INCLUDED_
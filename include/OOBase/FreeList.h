@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_FREE_LIST_H_INCLUDED_
+#define OOBASE_FREE_LIST_H_INCLUDED_
+
+#include "Atomic.h"
+
+namespace OOBase
+{
+	/// A lock-free stack of free blocks (a Treiber stack), shared between threads
+	/**
+	 *  Blocks are linked through their first word, so must be at least
+	 *  sizeof(void*) bytes.  A pop() racing with another may read the link of a
+	 *  block that has just been taken, so blocks must remain readable memory for
+	 *  as long as the FreeList is in use, e.g. by carving them from slabs that
+	 *  are only released with it.
+	 */
+	class FreeList : public NonCopyable
+	{
+	public:
+		FreeList()
+		{}
+
+		void push(void* ptr)
+		{
+			Node* node = static_cast<Node*>(ptr);
+			for (TaggedPtr<Node> head = m_head.load();;)
+			{
+				node->m_next = head.get();
+
+				TaggedPtr<Node> prev = m_head.CompareAndSwap(head,head.next(node));
+				if (prev == head)
+					break;
+				head = prev;
+			}
+		}
+
+		void* pop()
+		{
+			for (TaggedPtr<Node> head = m_head.load();head.get();)
+			{
+				// If head has been taken meanwhile, the link is stale and the tag will have moved on
+				Node* next = Atomic<Node*>::Load(head->m_next,memory_order_relaxed);
+
+				TaggedPtr<Node> prev = m_head.CompareAndSwap(head,head.next(next));
+				if (prev == head)
+					return head.get();
+				head = prev;
+			}
+			return NULL;
+		}
+
+		bool empty() const
+		{
+			return (m_head.load().get() == NULL);
+		}
+
+	private:
+		struct Node
+		{
+			Node* m_next;
+		};
+
+		Atomic<TaggedPtr<Node> > m_head;
+	};
+}
+
+#endif // OOBASE_FREE_LIST_H_INCLUDED_
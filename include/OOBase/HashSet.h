@@ -0,0 +1,266 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_HASHSET_H_INCLUDED_
+#define OOBASE_HASHSET_H_INCLUDED_
+
+#include "HashTable.h"
+
+namespace OOBase
+{
+	namespace detail
+	{
+		template <typename K, bool POD = false>
+		struct HashSetNode
+		{
+			typedef K value_type;
+
+			HashSetNode(size_t h, const K& key) : m_hash(h), m_data(key)
+			{}
+
+			static const K& key(const K& item)
+			{
+				return item;
+			}
+
+			static void inplace_copy(HashSetNode* p, size_t h, const K& key)
+			{
+				::new (p) HashSetNode(h,key);
+			}
+
+			static void inplace_destroy(HashSetNode& p)
+			{
+				p.m_data.~K();
+			}
+
+			size_t m_hash;
+			K m_data;
+		};
+
+		template <typename K>
+		struct HashSetNode<K,true>
+		{
+			typedef K value_type;
+
+			static const K& key(const K& item)
+			{
+				return item;
+			}
+
+			static void inplace_copy(void* p, size_t h, const K& key)
+			{
+				static_cast<HashSetNode*>(p)->m_hash = h;
+				static_cast<HashSetNode*>(p)->m_data = key;
+			}
+
+			static void inplace_destroy(HashSetNode&)
+			{}
+
+			size_t m_hash;
+			K m_data;
+		};
+	}
+
+	/// A Robin Hood open-addressed set of keys
+	/**
+	 *  The same bucket array as HashTable, but each bucket holds only the hash
+	 *  and the key, with no value alongside.  Erased keys leave tombstones, which
+	 *  rehash() or shrink_to_fit() clear out.
+	 */
+	template <typename K, typename Allocator = CrtAllocator, typename H = OOBase::Hash<K>, typename LoadFactor = HashLoadFactor<> >
+	class HashSet : public detail::HashTable::RobinHoodTable<detail::HashSetNode<K,detail::is_pod<K>::value>,Allocator,H,LoadFactor>
+	{
+	protected:
+		typedef detail::HashSetNode<K,detail::is_pod<K>::value> Node;
+
+	private:
+		typedef detail::HashTable::RobinHoodTable<Node,Allocator,H,LoadFactor> baseClass;
+
+	public:
+		// Keys are never changed in place, so both iterators are const
+		typedef detail::IteratorImpl<HashSet,const K,size_t> iterator;
+		friend class detail::IteratorImpl<HashSet,const K,size_t>;
+		typedef detail::IteratorImpl<const HashSet,const K,size_t> const_iterator;
+		friend class detail::IteratorImpl<const HashSet,const K,size_t>;
+
+		HashSet(const H& h = H()) : baseClass(h), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		{
+			iterator(this,size_t(-1)).swap(m_end);
+			const_iterator(this,size_t(-1)).swap(m_cend);
+		}
+
+		HashSet(AllocatorInstance& allocator, const H& h = H()) : baseClass(allocator,h), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		{
+			iterator(this,size_t(-1)).swap(m_end);
+			const_iterator(this,size_t(-1)).swap(m_cend);
+		}
+
+		HashSet(const HashSet& rhs) : baseClass(rhs), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		{
+			iterator(this,size_t(-1)).swap(m_end);
+			const_iterator(this,size_t(-1)).swap(m_cend);
+		}
+
+		HashSet& operator = (const HashSet& rhs)
+		{
+			HashSet(rhs).swap(*this);
+			return *this;
+		}
+
+		void swap(HashSet& rhs)
+		{
+			baseClass::swap(rhs);
+		}
+
+		iterator insert(typename call_traits<K>::param_type key)
+		{
+			size_t pos = baseClass::insert_i(key);
+			if (pos == size_t(-1))
+				return m_end;
+
+			return iterator(this,pos);
+		}
+
+		/// Add every key of rhs, in a single pass over it
+		bool insert_all(const HashSet& rhs)
+		{
+			return baseClass::insert_from(rhs);
+		}
+
+		/// Remove every key that is not also in rhs, in a single pass
+		template <typename A1, typename L1>
+		void intersect(const HashSet<K,A1,H,L1>& rhs)
+		{
+			for (size_t i=0;i<this->slots() && this->m_count;++i)
+			{
+				const K* key = this->at(i);
+				if (key && !rhs.exists(*key))
+					this->erase_i(i);
+			}
+		}
+
+		/// Remove every key that is also in rhs, in a single pass over whichever set is smaller
+		template <typename A1, typename L1>
+		void difference(const HashSet<K,A1,H,L1>& rhs)
+		{
+			if (rhs.size() < this->m_count)
+			{
+				for (typename HashSet<K,A1,H,L1>::const_iterator i = rhs.begin();i != rhs.end() && this->m_count;++i)
+					remove(*i);
+			}
+			else
+			{
+				for (size_t i=0;i<this->slots() && this->m_count;++i)
+				{
+					const K* key = this->at(i);
+					if (key && rhs.exists(*key))
+						this->erase_i(i);
+				}
+			}
+		}
+
+		template <typename K1>
+		const_iterator find(const K1& key) const
+		{
+			return const_iterator(this,this->find_i(key));
+		}
+
+		template <typename K1>
+		iterator find(const K1& key)
+		{
+			return iterator(this,this->find_i(key));
+		}
+
+		iterator erase(iterator iter)
+		{
+			assert(iter.check(this));
+			size_t pos = iter.deref();
+
+			if (this->at(pos))
+				this->erase_i(pos);
+
+			if (!this->at(pos))
+				this->next(pos);
+
+			return iterator(this,pos);
+		}
+
+		template <typename K1>
+		bool remove(const K1& key)
+		{
+			size_t pos = this->find_i(key);
+			if (pos == size_t(-1))
+				return false;
+
+			this->erase_i(pos);
+			return true;
+		}
+
+		bool pop(K* key = NULL)
+		{
+			iterator i = begin();
+			if (i == m_end)
+				return false;
+
+			if (key)
+				*key = *i;
+
+			erase(i);
+			return true;
+		}
+
+		iterator begin()
+		{
+			return iterator(this,this->first());
+		}
+
+		const_iterator cbegin() const
+		{
+			return const_iterator(this,this->first());
+		}
+
+		const_iterator begin() const
+		{
+			return cbegin();
+		}
+
+		iterator end()
+		{
+			return m_end;
+		}
+
+		const_iterator cend() const
+		{
+			return m_cend;
+		}
+
+		const_iterator end() const
+		{
+			return m_cend;
+		}
+
+	private:
+		iterator m_end;
+		const_iterator m_cend;
+	};
+}
+
+#endif // OOBASE_HASHSET_H_INCLUDED_
@@ -157,14 +157,42 @@ namespace OOBase
 				K k;
 				V v;
 			};
+
+			// Bucket hashes shared by the Robin Hood tables: 0 is an empty bucket, and the top bit marks a tombstone
+			struct RobinHood
+			{
+				static const size_t s_hi_bit = (size_t(1) << ((sizeof(size_t) * 8) - 1));
+
+				static bool is_deleted(size_t hash)
+				{
+					return (hash & s_hi_bit) != 0;
+				}
+
+				static bool is_in_use(size_t hash)
+				{
+					return hash != 0 && !is_deleted(hash);
+				}
+
+				static size_t probe_distance(size_t hash, size_t pos, size_t size)
+				{
+					return (pos + size - (hash & (size-1))) & (size-1);
+				}
+			};
 		}
 
 		template <typename K, typename V, bool POD = false>
 		struct HashTableNode
 		{
+			typedef Pair<K,V> value_type;
+
 			HashTableNode(size_t h, const Pair<K,V>& item) : m_hash(h), m_data(item)
 			{}
 
+			static const K& key(const Pair<K,V>& item)
+			{
+				return item.first;
+			}
+
 			static void inplace_copy(HashTableNode* p, size_t h, const Pair<K,V>& item)
 			{
 				::new (p) HashTableNode(h,item);
@@ -182,6 +210,13 @@ namespace OOBase
 		template <typename K, typename V>
 		struct HashTableNode<K,V,true>
 		{
+			typedef Pair<K,V> value_type;
+
+			static const K& key(const Pair<K,V>& item)
+			{
+				return item.first;
+			}
+
 			static void inplace_copy(void* p, size_t h, const Pair<K,V>& item)
 			{
 				static_cast<HashTableNode*>(p)->m_hash = h;
@@ -196,52 +231,496 @@ namespace OOBase
 		};
 	}
 
-	template <typename K, typename V, typename Allocator = CrtAllocator, typename H = OOBase::Hash<K> >
-	class HashTable : public Allocating<Allocator>
+	/// The load factor policy for HashTable: grow once more than Num/Den of the buckets are in use
+	/**
+	 *  max_count() always leaves at least one bucket empty, so Num must be less than Den,
+	 *  and allows at least one entry, so Num must not be zero.
+	 */
+	template <size_t Num = 9, size_t Den = 10>
+	struct HashLoadFactor
+	{
+		static size_t max_count(size_t buckets)
+		{
+			static_assert(Num > 0 && Num < Den,"HashLoadFactor must be between 0 and 1");
+
+			// buckets * Num / Den, split so that it cannot overflow
+			size_t count = buckets / Den * Num + (buckets % Den) * Num / Den;
+			if (count >= buckets && buckets)
+				count = buckets - 1;
+			return count;
+		}
+	};
+
+	namespace detail
 	{
-		typedef Allocating<Allocator> baseClass;
+		namespace HashTable
+		{
+			/// The Robin Hood bucket array behind HashTable and HashSet, parameterised on the node in each bucket
+			/**
+			 *  A Node has an m_hash and an m_data of its value_type, key() picks the key
+			 *  out of an m_data, and inplace_copy() and inplace_destroy() build and tear
+			 *  down a bucket.  The containers add their own iterators and public members.
+			 */
+			template <typename Node, typename Allocator, typename H, typename LoadFactor>
+			class RobinHoodTable : public Allocating<Allocator>, protected RobinHood
+			{
+				typedef Allocating<Allocator> baseClass;
+				typedef typename Node::value_type value_type;
+
+			public:
+				template <typename K1>
+				bool exists(const K1& key) const
+				{
+					return (find_i(key) != size_t(-1));
+				}
+
+				void clear()
+				{
+					destroy_all(m_data,m_size);
+					for (size_t i=0;i<m_size;++i)
+						m_data[i].m_hash = 0;
+
+					destroy_all(m_old,m_old_size);
+					baseClass::free(m_old);
+					m_old = NULL;
+					m_old_size = 0;
+					m_migrated = 0;
+
+					m_count = 0;
+				}
+
+				/// Make room for count entries without growing again
+				bool reserve(size_t count)
+				{
+					if (count <= LoadFactor::max_count(m_size))
+						return true;
+
+					return resize(buckets_for(count),false);
+				}
+
+				/// Rebuild at the current size, clearing out any tombstones
+				bool rehash()
+				{
+					return (m_size ? resize(m_size,false) : true);
+				}
+
+				/// Rebuild at the smallest size that holds the current entries
+				bool shrink_to_fit()
+				{
+					if (m_count)
+						return resize(buckets_for(m_count),false);
+
+					clear();
+					baseClass::free(m_data);
+					m_data = NULL;
+					m_size = 0;
+					return true;
+				}
+
+				bool empty() const
+				{
+					return (m_count == 0);
+				}
+
+				size_t size() const
+				{
+					return m_count;
+				}
+
+			protected:
+				RobinHoodTable(const H& h) : baseClass(), m_data(NULL), m_size(0), m_count(0), m_hash(h), m_old(NULL), m_old_size(0), m_migrated(0), m_incremental(false)
+				{}
+
+				RobinHoodTable(AllocatorInstance& allocator, const H& h) : baseClass(allocator), m_data(NULL), m_size(0), m_count(0), m_hash(h), m_old(NULL), m_old_size(0), m_migrated(0), m_incremental(false)
+				{}
+
+				RobinHoodTable(const RobinHoodTable& rhs) : baseClass(rhs), m_data(NULL), m_size(0), m_count(0), m_hash(rhs.m_hash), m_old(NULL), m_old_size(0), m_migrated(0), m_incremental(rhs.m_incremental)
+				{
+					insert_from(rhs);
+				}
+
+				~RobinHoodTable()
+				{
+					destroy_all(m_data,m_size);
+					destroy_all(m_old,m_old_size);
+					baseClass::free(m_data);
+					baseClass::free(m_old);
+				}
+
+				void swap(RobinHoodTable& rhs)
+				{
+					baseClass::swap(rhs);
+					OOBase::swap(m_data,rhs.m_data);
+					OOBase::swap(m_size,rhs.m_size);
+					OOBase::swap(m_count,rhs.m_count);
+					OOBase::swap(m_hash,rhs.m_hash);
+					OOBase::swap(m_old,rhs.m_old);
+					OOBase::swap(m_old_size,rhs.m_old_size);
+					OOBase::swap(m_migrated,rhs.m_migrated);
+					OOBase::swap(m_incremental,rhs.m_incremental);
+				}
+
+				void set_incremental(bool incremental)
+				{
+					m_incremental = incremental;
+					if (!incremental)
+						migrate(m_old_size);
+				}
+
+				Node*    m_data;
+				size_t   m_size;
+				size_t   m_count;
+				H        m_hash;
+
+				// While rehashing incrementally, the array being emptied and how far through it we are
+				Node*    m_old;
+				size_t   m_old_size;
+				size_t   m_migrated;
+				bool     m_incremental;
+
+				// Old buckets moved across per insert, which easily finishes before the new array fills
+				static const size_t s_migrate_step = 16;
+
+				/// Insert item, replacing an entry with the same key, and return its position, or size_t(-1) if the table cannot grow
+				size_t insert_i(const value_type& item)
+				{
+					if (m_count >= LoadFactor::max_count(m_size) && !resize(m_size == 0 ? 16 : m_size * 2,m_incremental))
+						return size_t(-1);
+
+					size_t h = hash_i(Node::key(item));
+					if (m_old)
+					{
+						migrate(s_migrate_step);
+
+						// A key still in the old array is replaced where it is
+						if (m_old)
+						{
+							size_t old_pos = find_in(Node::key(item),h,m_old,m_old_size);
+							if (old_pos != size_t(-1))
+							{
+								m_old[old_pos].m_data = item;
+								return m_size + old_pos;
+							}
+						}
+					}
+
+					size_t pos = 0;
+					if (insert_in(item,h,pos))
+						++m_count;
+					return pos;
+				}
+
+				/// Add every entry of rhs, sizing the table once up front
+				bool insert_from(const RobinHoodTable& rhs)
+				{
+					if (!reserve(m_count + rhs.m_count))
+						return false;
+
+					for (size_t i=0;i<rhs.slots();++i)
+					{
+						const value_type* p = rhs.at(i);
+						if (p && insert_i(*p) == size_t(-1))
+							return false;
+					}
+					return true;
+				}
+
+				/// Erase the entry at pos, leaving a tombstone so that the positions of the others never change
+				void erase_i(size_t pos)
+				{
+					Node& n = node(pos);
+					Node::inplace_destroy(n);
+					n.m_hash |= s_hi_bit;
+					--m_count;
+				}
+
+				template <typename K1>
+				size_t find_i(const K1& key) const
+				{
+					if (m_count == 0)
+						return size_t(-1);
+
+					size_t h = hash_i(key);
+					size_t pos = find_in(key,h,m_data,m_size);
+					if (pos == size_t(-1) && m_old)
+					{
+						pos = find_in(key,h,m_old,m_old_size);
+						if (pos != size_t(-1))
+							pos += m_size;
+					}
+					return pos;
+				}
+
+				// Positions past m_size address the old array
+				size_t slots() const
+				{
+					return m_size + m_old_size;
+				}
+
+				Node& node(size_t pos)
+				{
+					return (pos < m_size ? m_data[pos] : m_old[pos - m_size]);
+				}
+
+				const Node& node(size_t pos) const
+				{
+					return (pos < m_size ? m_data[pos] : m_old[pos - m_size]);
+				}
+
+				value_type* at(size_t pos)
+				{
+					return (pos < slots() && is_in_use(node(pos).m_hash) ? &node(pos).m_data : NULL);
+				}
+
+				const value_type* at(size_t pos) const
+				{
+					return (pos < slots() && is_in_use(node(pos).m_hash) ? &node(pos).m_data : NULL);
+				}
+
+				size_t first() const
+				{
+					for (size_t i=0;i<slots();++i)
+					{
+						if (is_in_use(node(i).m_hash))
+							return i;
+					}
+					return size_t(-1);
+				}
+
+				void next(size_t& pos) const
+				{
+					while (++pos < slots() && !is_in_use(node(pos).m_hash))
+						;
+
+					if (pos >= slots())
+						pos = size_t(-1);
+				}
+
+				void prev(size_t& pos) const
+				{
+					if (pos > slots())
+						pos = slots();
+
+					while (pos-- > 0 && !is_in_use(node(pos).m_hash))
+						;
+				}
+
+				void iterator_move(size_t& pos, ptrdiff_t n) const
+				{
+					for (ptrdiff_t i = 0;i < n && pos < slots();++i)
+						next(pos);
+					for (ptrdiff_t i = n;i < 0 && pos < slots();++i)
+						prev(pos);
+				}
+
+			private:
+				template <typename K1>
+				size_t hash_i(const K1& key) const
+				{
+					size_t h = m_hash.hash(key);
+
+					// Clear top bit
+					h &= ~s_hi_bit;
+
+					// Never use 0 as it is used as marker
+					if (!h)
+						h = 1;
+
+					return h;
+				}
+
+				template <typename K1>
+				static size_t find_in(const K1& key, size_t h, const Node* data, size_t size)
+				{
+					if (!size)
+						return size_t(-1);
+
+					size_t pos = h & (size-1);
+					for (size_t dist = 0;;++dist)
+					{
+						if (!data[pos].m_hash || dist > probe_distance(data[pos].m_hash,pos,size))
+							break;
+
+						if (data[pos].m_hash == h && Node::key(data[pos].m_data) == key)
+							return pos;
+
+						pos = (pos + 1) & (size-1);
+					}
+
+					return size_t(-1);
+				}
+
+				// Find the key of item in m_data and replace it, or put item where the search stopped: returns true if it was added
+				bool insert_in(const value_type& item, size_t h, size_t& pos)
+				{
+					pos = h & (m_size-1);
+					for (size_t dist = 0;;++dist)
+					{
+						if (!m_data[pos].m_hash || dist > probe_distance(m_data[pos].m_hash,pos,m_size))
+							break;
+
+						if (m_data[pos].m_hash == h && Node::key(m_data[pos].m_data) == Node::key(item))
+						{
+							m_data[pos].m_data = item;
+							return false;
+						}
+
+						pos = (pos + 1) & (m_size-1);
+					}
+
+					if (!is_in_use(m_data[pos].m_hash))
+					{
+						// An empty bucket, or a tombstone that has probed less than us
+						Node::inplace_copy(&m_data[pos],h,item);
+						return true;
+					}
+
+					// Robin Hood: take the place of the richer entry, and find it a new home
+					value_type displaced(m_data[pos].m_data);
+					size_t displaced_hash = m_data[pos].m_hash;
+					Node::inplace_destroy(m_data[pos]);
+					Node::inplace_copy(&m_data[pos],h,item);
+
+					place(displaced,displaced_hash,pos);
+					return true;
+				}
+
+				// Put item, which is known not to be present, in the first bucket after pos that will take it
+				void place(value_type& item, size_t h, size_t pos)
+				{
+					for (size_t dist = probe_distance(h,pos,m_size) + 1;;++dist)
+					{
+						pos = (pos + 1) & (m_size-1);
+						if (!m_data[pos].m_hash)
+							break;
+
+						size_t curr_dist = probe_distance(m_data[pos].m_hash,pos,m_size);
+						if (curr_dist < dist)
+						{
+							if (is_deleted(m_data[pos].m_hash))
+								break;
+
+							OOBase::swap(m_data[pos].m_hash,h);
+							OOBase::swap(m_data[pos].m_data,item);
+							dist = curr_dist;
+						}
+					}
+
+					Node::inplace_copy(&m_data[pos],h,item);
+				}
+
+				static void destroy_all(Node* data, size_t size)
+				{
+					for (size_t i=0;i<size;++i)
+					{
+						if (is_in_use(data[i].m_hash))
+							Node::inplace_destroy(data[i]);
+					}
+				}
+
+				static size_t buckets_for(size_t count)
+				{
+					size_t size = 16;
+					while (LoadFactor::max_count(size) < count && size < (size_t(1) << (sizeof(size_t)*8 - 2)))
+						size *= 2;
+
+					return size;
+				}
+
+				bool resize(size_t new_size, bool incremental)
+				{
+					// Never start a rehash while one is still going
+					migrate(m_old_size);
+
+					Node* new_data = static_cast<Node*>(baseClass::allocate(new_size * sizeof(Node),alignment_of<Node>::value));
+					if (!new_data)
+						return false;
+
+					// Set nothing in use
+					for (size_t i=0;i<new_size;++i)
+						new_data[i].m_hash = 0;
+
+					m_old = m_data;
+					m_old_size = m_size;
+					m_migrated = 0;
+					m_data = new_data;
+					m_size = new_size;
 
+					if (!incremental)
+						migrate(m_old_size);
+
+					return true;
+				}
+
+				void migrate(size_t buckets)
+				{
+					for (;buckets && m_migrated < m_old_size;--buckets,++m_migrated)
+					{
+						Node& n = m_old[m_migrated];
+						if (is_in_use(n.m_hash))
+						{
+							size_t pos = 0;
+							insert_in(n.m_data,n.m_hash,pos);
+							Node::inplace_destroy(n);
+
+							// Leave a tombstone, so probes through here still reach the rest of the old array
+							n.m_hash |= s_hi_bit;
+						}
+					}
+
+					if (m_old && m_migrated == m_old_size)
+					{
+						baseClass::free(m_old);
+						m_old = NULL;
+						m_old_size = 0;
+						m_migrated = 0;
+					}
+				}
+			};
+		}
+	}
+
+	/// A Robin Hood open-addressed hash table
+	/**
+	 *  By default the table grows all at once, re-inserting every entry.  With
+	 *  set_incremental(true) it keeps the old array alongside the new one instead,
+	 *  and each insert moves a few more of the old buckets across, so no single
+	 *  insert pays for the whole rehash.  Lookups check both arrays meanwhile.
+	 *
+	 *  Erased entries leave tombstones behind, which only a rehash clears out:
+	 *  call rehash() or shrink_to_fit() after removing a lot of entries.
+	 */
+	template <typename K, typename V, typename Allocator = CrtAllocator, typename H = OOBase::Hash<K>, typename LoadFactor = HashLoadFactor<> >
+	class HashTable : public detail::HashTable::RobinHoodTable<detail::HashTableNode<K,V,detail::is_pod<detail::HashTable::PODCheck<K,V> >::value>,Allocator,H,LoadFactor>
+	{
 	protected:
 		typedef detail::HashTableNode<K,V,detail::is_pod<detail::HashTable::PODCheck<K,V> >::value> Node;
 
+	private:
+		typedef detail::HashTable::RobinHoodTable<Node,Allocator,H,LoadFactor> baseClass;
+
 	public:
 		typedef detail::IteratorImpl<HashTable,Pair<K,V>,size_t> iterator;
 		friend class detail::IteratorImpl<HashTable,Pair<K,V>,size_t>;
 		typedef detail::IteratorImpl<const HashTable,const Pair<K,V>,size_t> const_iterator;
 		friend class detail::IteratorImpl<const HashTable,const Pair<K,V>,size_t>;
 
-		HashTable(const H& h = H()) : baseClass(), m_data(NULL), m_size(0), m_count(0), m_hash(h), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		HashTable(const H& h = H()) : baseClass(h), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
 		{
 			iterator(this,size_t(-1)).swap(m_end);
 			const_iterator(this,size_t(-1)).swap(m_cend);
 		}
 
-		HashTable(AllocatorInstance& allocator, const H& h = H()) : baseClass(allocator), m_data(NULL), m_size(0), m_count(0), m_hash(h), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		HashTable(AllocatorInstance& allocator, const H& h = H()) : baseClass(allocator,h), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
 		{
 			iterator(this,size_t(-1)).swap(m_end);
 			const_iterator(this,size_t(-1)).swap(m_cend);
 		}
 
-		HashTable(const HashTable& rhs) : baseClass(rhs), m_data(NULL), m_size(0), m_count(0), m_hash(rhs.m_hash), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
+		HashTable(const HashTable& rhs) : baseClass(rhs), m_end(NULL,size_t(-1)), m_cend(NULL,size_t(-1))
 		{
 			iterator(this,size_t(-1)).swap(m_end);
 			const_iterator(this,size_t(-1)).swap(m_cend);
-
-			for (size_t i=0;i<rhs.m_size;++i)
-			{
-				if (is_in_use(rhs.m_data[i].m_hash) && !insert(rhs.m_data[i].m_data))
-					break;
-			}
-		}
-
-		~HashTable()
-		{
-			for (size_t i=0;i<m_size && m_count;++i)
-			{
-				if (is_in_use(m_data[i].m_hash))
-					Node::inplace_destroy(m_data[i]);
-			}
-			baseClass::free(m_data);
 		}
 
 		HashTable& operator = (const HashTable& rhs)
@@ -253,17 +732,18 @@ namespace OOBase
 		void swap(HashTable& rhs)
 		{
 			baseClass::swap(rhs);
-			OOBase::swap(m_data,rhs.m_data);
-			OOBase::swap(m_size,rhs.m_size);
-			OOBase::swap(m_count,rhs.m_count);
-			OOBase::swap(m_hash,rhs.m_hash);
+		}
+
+		/// Grow a few buckets at a time rather than all at once, turning it off finishes any rehash in progress
+		void set_incremental(bool incremental)
+		{
+			baseClass::set_incremental(incremental);
 		}
 
 		iterator insert(typename call_traits<K>::param_type key, typename call_traits<V>::param_type value)
 		{
-			size_t pos = 0;
-			Pair<K,V> temp_item(key,value);
-			if (!insert_i(pos,temp_item))
+			size_t pos = baseClass::insert_i(Pair<K,V>(key,value));
+			if (pos == size_t(-1))
 				return m_end;
 
 			return iterator(this,pos);
@@ -274,32 +754,47 @@ namespace OOBase
 			return insert(item.first,item.second);
 		}
 
-		template <typename K1>
-		bool exists(const K1& key) const
+		/// Replace the contents with [first,last), sizing the table once up front
+		template <typename It>
+		bool build_from(It first, It last)
 		{
-			return (find_i(key) < m_size);
+			this->clear();
+
+			size_t count = 0;
+			for (It i = first; i != last; ++i)
+				++count;
+
+			if (!this->reserve(count))
+				return false;
+
+			for (It i = first; i != last; ++i)
+			{
+				if (insert(*i) == m_end)
+					return false;
+			}
+			return true;
 		}
 
 		template <typename K1>
 		const_iterator find(const K1& key) const
 		{
-			return const_iterator(this,find_i(key));
+			return const_iterator(this,this->find_i(key));
 		}
 
 		template <typename K1>
 		iterator find(const K1& key)
 		{
-			return iterator(this,find_i(key));
+			return iterator(this,this->find_i(key));
 		}
 
 		template <typename K1>
 		bool find(const K1& key, V& val) const
 		{
-			size_t pos = find_i(key);
+			size_t pos = this->find_i(key);
 			if (pos == size_t(-1))
 				return false;
 
-			val = m_data[pos].m_data.second;
+			val = this->node(pos).m_data.second;
 			return true;
 		}
 
@@ -308,19 +803,11 @@ namespace OOBase
 			assert(iter.check(this));
 			size_t pos = iter.deref();
 
-			if (is_in_use(m_data[pos].m_hash))
-			{
-				Node::inplace_destroy(m_data[pos]);
-				--m_count;
-
-				ripple(pos);
-			}
-
-			while (pos < m_size && !is_in_use(m_data[pos].m_hash))
-				++pos;
+			if (this->at(pos))
+				this->erase_i(pos);
 
-			if (pos >= m_size)
-				pos = size_t(-1);
+			if (!this->at(pos))
+				this->next(pos);
 
 			return iterator(this,pos);
 		}
@@ -355,49 +842,14 @@ namespace OOBase
 			return true;
 		}
 
-		void clear()
-		{
-			for (size_t i=0;i<m_size && m_count;++i)
-			{
-				if (is_in_use(m_data[i].m_hash))
-				{
-					Node::inplace_destroy(m_data[i]);
-					m_data[i].m_hash = 0;
-				}
-			}
-			m_count = 0;
-		}
-
-		bool empty() const
-		{
-			return (m_count == 0);
-		}
-
-		size_t size() const
-		{
-			return m_count;
-		}
-
 		iterator begin()
 		{
-			for (size_t i=0;i<m_size;++i)
-			{
-				if (is_in_use(m_data[i].m_hash))
-					return iterator(this,i);
-			}
-
-			return m_end;
+			return iterator(this,this->first());
 		}
 
 		const_iterator cbegin() const
 		{
-			for (size_t i=0;i<m_size;++i)
-			{
-				if (is_in_use(m_data[i].m_hash))
-					return const_iterator(this,i);
-			}
-
-			return m_cend;
+			return const_iterator(this,this->first());
 		}
 
 		const_iterator begin() const
@@ -421,218 +873,8 @@ namespace OOBase
 		}
 
 	private:
-		Node*    m_data;
-		size_t   m_size;
-		size_t   m_count;
-		H        m_hash;
-
 		iterator m_end;
 		const_iterator m_cend;
-
-		static const size_t s_hi_bit = (size_t(1) << ((sizeof(size_t) * 8) - 1));
-
-		template <typename K1>
-		size_t hash_i(const K1& key) const
-		{
-			size_t h = m_hash.hash(key);
-
-			// Clear top bit
-			h &= ~s_hi_bit;
-
-			// Never use 0 as it is used as marker
-			if (!h)
-				h = 1;
-
-			return h;
-		}
-
-		size_t desired_pos(size_t hash) const
-		{
-			return hash & (m_size-1);
-		}
-
-		static bool is_deleted(size_t hash)
-		{
-			// Top bit is used as a tombstone
-			return (hash & s_hi_bit) != 0;
-		}
-
-		static bool is_in_use(size_t hash)
-		{
-			return hash != 0 && !is_deleted(hash);
-		}
-
-		size_t probe_distance(size_t hash, size_t pos) const
-		{
-			return (pos + m_size - (hash & (m_size-1))) & (m_size-1);
-		}
-
-		template <typename K1>
-		size_t find_i(const K1& key) const
-		{
-			if (m_count == 0)
-				return size_t(-1);
-
-			size_t h = hash_i(key);
-			size_t pos = h & (m_size-1);
-			for (size_t dist = 0;;++dist)
-			{
-				if (!m_data[pos].m_hash || dist > probe_distance(m_data[pos].m_hash,pos))
-					break;
-
-				if (m_data[pos].m_hash == h && m_data[pos].m_data.first == key)
-					return pos;
-
-				pos = (pos + 1) & (m_size-1);
-			}
-
-			return size_t(-1);
-		}
-
-		bool grow()
-		{
-			size_t new_size = (m_size == 0 ? 16 : m_size * 2);
-			Node* new_data = static_cast<Node*>(baseClass::allocate(new_size * sizeof(Node),alignment_of<Node>::value));
-			if (!new_data)
-				return false;
-
-			// Set nothing in use
-			for (size_t i=0;i<new_size;++i)
-				new_data[i].m_hash = 0;
-
-			// Now insert the contents of m_data into copy
-			size_t c = 0;
-			for (size_t i=0;i<m_size && c<m_count;++i)
-			{
-				if (is_in_use(m_data[i].m_hash))
-				{
-					++c;
-					size_t count = 0;
-					insert_other(m_data[i].m_data,new_size,new_data,count);
-				}
-			}
-
-			baseClass::free(m_data);
-			m_data = new_data;
-			m_size = new_size;
-
-			return true;
-		}
-
-		size_t insert_other(Pair<K,V>& item, size_t size, Node* data, size_t& count)
-		{
-			size_t pos = 0;
-			size_t h = hash_i(item.first);
-			pos = h & (size-1);
-			for (size_t dist = 0;;++dist)
-			{
-				if (!data[pos].m_hash)
-				{
-					Node::inplace_copy(&data[pos],h,item);
-					++count;
-					break;
-				}
-
-				if (data[pos].m_hash == h && data[pos].m_data.first == item.first)
-				{
-					// Replace existing
-					Node::inplace_copy(&data[pos],h,item);
-					break;
-				}
-
-				// If the existing element has probed less than us then swap, Robin Hood!
-				size_t curr_dist = probe_distance(data[pos].m_hash,pos);
-				if (curr_dist < dist)
-				{
-					if (is_deleted(data[pos].m_hash))
-					{
-						Node::inplace_copy(&data[pos],h,item);
-						++count;
-						break;
-					}
-
-					OOBase::swap(data[pos].m_hash,h);
-					OOBase::swap(data[pos].m_data,item);
-										
-					dist = curr_dist;
-				}
-
-				pos = (pos + 1) & (size-1);
-			}
-
-			return pos;
-		}
-
-		bool insert_i(size_t& pos, Pair<K,V>& item)
-		{
-			if (m_count >= (m_size / 10 * 9))
-			{
-				if (!grow())
-					return false;
-			}
-
-			pos = insert_other(item,m_size,m_data,m_count);
-			return true;
-		}
-
-		void ripple(size_t start)
-		{
-			size_t pos = start;
-			for (int i=0;i < 3;++i)
-			{
-				size_t next = (pos & (m_size-1));
-				if (next == start)
-					break;
-
-				if (!m_data[next].m_hash || probe_distance(m_data[next].m_hash,next) == 0)
-				{
-					m_data[pos].m_hash = 0;
-					return;
-				}
-
-				Node::inplace_copy(&m_data[pos],m_data[next].m_hash,m_data[next].m_data);
-				Node::inplace_destroy(m_data[next]);
-
-				pos = next;
-			}
-			m_data[pos].m_hash |= s_hi_bit;
-		}
-
-		Pair<K,V>* at(size_t pos)
-		{
-			return (pos < m_size && is_in_use(m_data[pos].m_hash) ? &m_data[pos].m_data : NULL);
-		}
-
-		const Pair<K,V>* at(size_t pos) const
-		{
-			return (pos < m_size && is_in_use(m_data[pos].m_hash) ? &m_data[pos].m_data : NULL);
-		}
-
-		void next(size_t& pos) const
-		{
-			while (++pos < m_size && !is_in_use(m_data[pos].m_hash))
-				;
-
-			if (pos >= m_size)
-				pos = size_t(-1);
-		}
-
-		void prev(size_t& pos) const
-		{
-			if (pos > m_size)
-				pos = m_size;
-
-			while (pos-- > 0 && !is_in_use(m_data[pos].m_hash))
-				;
-		}
-
-		void iterator_move(size_t& pos, ptrdiff_t n) const
-		{
-			for (ptrdiff_t i = 0;i < n && pos < m_size;++i)
-				next(pos);
-			for (ptrdiff_t i = n;i < 0 && pos < m_size;++i)
-				prev(pos);
-		}
 	};
 }
 
@@ -0,0 +1,320 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_LOCK_FREE_QUEUE_H_INCLUDED_
+#define OOBASE_LOCK_FREE_QUEUE_H_INCLUDED_
+
+#include "Condition.h"
+#include "Atomic.h"
+
+namespace OOBase
+{
+	/// A multi-producer, multi-consumer bounded queue
+	/**
+	 *  A drop-in alternative to BoundedQueue.  Items live in a fixed ring of
+	 *  sequenced cells, so push() and pop() only ever contend on a
+	 *  compare-and-swap of the head or tail index, each of which sits on its
+	 *  own cache line.  The lock and conditions are only touched when the
+	 *  ring is truly full or empty and a caller has to wait.
+	 *
+	 *  The bound is rounded up to the next power of two.
+	 */
+	template <typename T, typename Allocator = CrtAllocator>
+	class LockFreeBoundedQueue : public Allocating<Allocator>
+	{
+		typedef Allocating<Allocator> baseClass;
+
+	public:
+		enum Result
+		{
+			success = 0,
+			timedout,
+			closed,
+			pulsed,
+			error
+		};
+
+		LockFreeBoundedQueue(size_t bound = 16) : baseClass()
+		{
+			init(bound);
+		}
+
+		LockFreeBoundedQueue(AllocatorInstance& allocator, size_t bound = 16) : baseClass(allocator)
+		{
+			init(bound);
+		}
+
+		~LockFreeBoundedQueue()
+		{
+			close();
+
+			if (m_cells)
+			{
+				for (size_t pos = m_dequeue;pos != m_enqueue;++pos)
+					m_cells[pos & m_mask].m_value.~T();
+
+				baseClass::free(m_cells);
+			}
+		}
+
+		bool errored() const
+		{
+			return (m_cells == NULL);
+		}
+
+		size_t capacity() const
+		{
+			return m_mask + 1;
+		}
+
+		Result push(typename call_traits<T>::param_type val, const Timeout& timeout = Timeout())
+		{
+			if (!m_cells)
+				return error;
+
+			for (;;)
+			{
+				if (m_closed)
+					return closed;
+
+				if (try_push(val))
+					break;
+
+				// Full, so we have to wait for space
+				Guard<Condition::Mutex> guard(m_lock);
+
+				++m_push_waiters;
+
+				// Re-check now we are counted, a pop() may have raced us
+				while (!m_closed && full())
+				{
+					if (!m_space.wait(m_lock,timeout))
+					{
+						--m_push_waiters;
+						return timedout;
+					}
+				}
+
+				--m_push_waiters;
+			}
+
+			// The release store that published the cell must be visible before the waiter count is read,
+			// as a waiter counts itself in and then re-checks the cells: without this both could miss
+			detail::atomic_thread_fence(memory_order_seq_cst);
+			if (m_pop_waiters != 0)
+			{
+				Guard<Condition::Mutex> guard(m_lock);
+				m_available.signal();
+			}
+
+			return success;
+		}
+
+		Result pop(T& val, const Timeout& timeout = Timeout())
+		{
+			if (!m_cells)
+				return error;
+
+			size_t pulse = m_pulse;
+			for (;;)
+			{
+				if (try_pop(val))
+					break;
+
+				if (m_closed)
+					return closed;
+
+				// Empty, so we have to wait for an item
+				Guard<Condition::Mutex> guard(m_lock);
+
+				++m_pop_waiters;
+
+				// Re-check now we are counted, a push() may have raced us
+				while (!m_closed && empty())
+				{
+					if (m_pulse != pulse)
+					{
+						--m_pop_waiters;
+						return pulsed;
+					}
+
+					if (!m_available.wait(m_lock,timeout))
+					{
+						--m_pop_waiters;
+						return timedout;
+					}
+				}
+
+				--m_pop_waiters;
+			}
+
+			// As in push(), order the cell hand-back before the waiter count is read
+			detail::atomic_thread_fence(memory_order_seq_cst);
+			if (m_push_waiters != 0)
+			{
+				Guard<Condition::Mutex> guard(m_lock);
+				m_space.signal();
+			}
+
+			return success;
+		}
+
+		void close()
+		{
+			Guard<Condition::Mutex> guard(m_lock);
+
+			m_closed = 1;
+
+			m_available.broadcast();
+			m_space.broadcast();
+		}
+
+		/// Wake every thread currently blocked in pop(), returning pulsed
+		void pulse()
+		{
+			Guard<Condition::Mutex> guard(m_lock);
+
+			++m_pulse;
+
+			m_available.broadcast();
+		}
+
+	private:
+		struct Cell
+		{
+			size_t m_seq;
+			T      m_value;
+		};
+
+		// The indices are padded apart so producers and consumers do not false-share
+		char             m_pad0[OOBASE_CACHE_LINE_SIZE];
+		Atomic<size_t>   m_enqueue;
+		char             m_pad1[OOBASE_CACHE_LINE_SIZE - sizeof(size_t)];
+		Atomic<size_t>   m_dequeue;
+		char             m_pad2[OOBASE_CACHE_LINE_SIZE - sizeof(size_t)];
+
+		Cell*            m_cells;
+		size_t           m_mask;
+		Atomic<int>      m_closed;
+		Atomic<size_t>   m_pulse;
+		Atomic<size_t>   m_push_waiters;
+		Atomic<size_t>   m_pop_waiters;
+		Condition::Mutex m_lock;
+		Condition        m_available;
+		Condition        m_space;
+
+		void init(size_t bound)
+		{
+			m_enqueue = 0;
+			m_dequeue = 0;
+			m_closed = 0;
+			m_pulse = 0;
+			m_push_waiters = 0;
+			m_pop_waiters = 0;
+
+			m_mask = 2;
+			while (m_mask < bound)
+				m_mask <<= 1;
+
+			m_cells = static_cast<Cell*>(baseClass::allocate(sizeof(Cell) * m_mask,alignment_of<Cell>::value));
+			if (m_cells)
+			{
+				for (size_t i=0;i<m_mask;++i)
+					m_cells[i].m_seq = i;
+			}
+			--m_mask;
+		}
+
+		bool full() const
+		{
+			size_t pos = m_enqueue.load(memory_order_relaxed);
+			return (static_cast<ptrdiff_t>(Atomic<size_t>::Load(m_cells[pos & m_mask].m_seq,memory_order_acquire) - pos) < 0);
+		}
+
+		bool empty() const
+		{
+			size_t pos = m_dequeue.load(memory_order_relaxed);
+			return (static_cast<ptrdiff_t>(Atomic<size_t>::Load(m_cells[pos & m_mask].m_seq,memory_order_acquire) - (pos + 1)) < 0);
+		}
+
+		bool try_push(typename call_traits<T>::param_type val)
+		{
+			Cell* cell = NULL;
+			for (size_t pos = m_enqueue.load(memory_order_relaxed);;)
+			{
+				cell = &m_cells[pos & m_mask];
+
+				// Acquire the slot's last pop before reusing it
+				ptrdiff_t dif = static_cast<ptrdiff_t>(Atomic<size_t>::Load(cell->m_seq,memory_order_acquire) - pos);
+				if (dif < 0)
+					return false;
+
+				if (dif > 0)
+					pos = m_enqueue.load(memory_order_relaxed);
+				else
+				{
+					size_t old = m_enqueue.CompareAndSwap(pos,pos+1,memory_order_relaxed);
+					if (old == pos)
+					{
+						::new (&cell->m_value) T(val);
+
+						// Publish the value to the consumers
+						Atomic<size_t>::Store(cell->m_seq,pos + 1,memory_order_release);
+						return true;
+					}
+					pos = old;
+				}
+			}
+		}
+
+		bool try_pop(T& val)
+		{
+			Cell* cell = NULL;
+			for (size_t pos = m_dequeue.load(memory_order_relaxed);;)
+			{
+				cell = &m_cells[pos & m_mask];
+
+				ptrdiff_t dif = static_cast<ptrdiff_t>(Atomic<size_t>::Load(cell->m_seq,memory_order_acquire) - (pos + 1));
+				if (dif < 0)
+					return false;
+
+				if (dif > 0)
+					pos = m_dequeue.load(memory_order_relaxed);
+				else
+				{
+					size_t old = m_dequeue.CompareAndSwap(pos,pos+1,memory_order_relaxed);
+					if (old == pos)
+					{
+						val = cell->m_value;
+						cell->m_value.~T();
+
+						// Hand the cell back to the producers, one lap on
+						Atomic<size_t>::Store(cell->m_seq,pos + m_mask + 1,memory_order_release);
+						return true;
+					}
+					pos = old;
+				}
+			}
+		}
+	};
+}
+
+#endif // OOBASE_LOCK_FREE_QUEUE_H_INCLUDED_
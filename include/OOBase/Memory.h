@@ -30,6 +30,8 @@
 
 namespace OOBase
 {
+	struct AllocatorStats;
+
 	template <typename Derived>
 	class AllocateNewStatic
 	{
@@ -328,6 +330,9 @@ namespace OOBase
 		static void* allocate(size_t bytes, size_t align = 16);
 		static void* reallocate(void* ptr, size_t bytes, size_t align = 16);
 		static void free(void* ptr);
+
+		/// Process-wide counters, only collected when built with OOBASE_ALLOC_STATS
+		static bool get_stats(AllocatorStats& stats);
 	};
 
 	template <typename Derived>
@@ -569,6 +574,12 @@ namespace OOBase
 		virtual void* allocate(size_t bytes, size_t align) = 0;
 		virtual void* reallocate(void* ptr, size_t bytes, size_t align) = 0;
 		virtual void free(void* ptr) = 0;
+
+		/// Fill in stats, if this allocator keeps any
+		virtual bool get_stats(AllocatorStats& /*stats*/) const
+		{
+			return false;
+		}
 	};
 
 	class ThreadLocalAllocator : public AllocateNewStatic<ThreadLocalAllocator>
@@ -577,6 +588,12 @@ namespace OOBase
 		static void* allocate(size_t bytes, size_t align = 16);
 		static void* reallocate(void* ptr, size_t bytes, size_t align = 16);
 		static void free(void* ptr);
+
+		/// Counters for every thread's heap, only collected when built with OOBASE_ALLOC_STATS
+		static bool get_stats(AllocatorStats& stats);
+
+		/// Counters for blocks allocated by the calling thread, only collected when built with OOBASE_ALLOC_STATS
+		static bool get_thread_stats(AllocatorStats& stats);
 	};
 
 	template <typename Allocator = CrtAllocator>
@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_MONOTONIC_ARENA_H_INCLUDED_
+#define OOBASE_MONOTONIC_ARENA_H_INCLUDED_
+
+#include "Memory.h"
+
+namespace OOBase
+{
+	/// A bump-pointer allocator for short-lived data
+	/**
+	 *  Allocations are carved sequentially out of a chain of heap blocks, each
+	 *  twice the size of the last, optionally starting with a caller supplied
+	 *  buffer.  free() does nothing: all memory is reclaimed at once by reset()
+	 *  or release(), or when the arena is destroyed.  Each allocation is
+	 *  preceded by its size, so reallocate() never copies past the old block.
+	 */
+	class MonotonicArena : public AllocatorInstance
+	{
+	public:
+		MonotonicArena(size_t block_size = 4096);
+		MonotonicArena(char* buffer, size_t len, size_t block_size = 4096);
+		virtual ~MonotonicArena();
+
+		void* allocate(size_t bytes, size_t align);
+		void* reallocate(void* ptr, size_t bytes, size_t align);
+		void free(void* ptr);
+
+		/// Reclaim everything, but keep the largest heap block for reuse
+		void reset();
+
+		/// Reclaim everything and return all heap blocks to the CrtAllocator
+		void release();
+
+	private:
+		struct Block
+		{
+			Block* m_next;
+			size_t m_size;
+		};
+
+		char*  m_buffer;
+		size_t m_buffer_len;
+		size_t m_block_size;
+		size_t m_next_size;
+		Block* m_blocks;
+		Block* m_spare;
+		char*  m_cur;
+		char*  m_end;
+		char*  m_last;
+
+		bool new_block(size_t bytes, size_t align);
+		void free_blocks();
+		void rewind();
+	};
+
+	/// A MonotonicArena seeded with SIZE bytes of inline storage, in the manner of StackAllocator
+	template <size_t SIZE>
+	class StackMonotonicArena : public MonotonicArena
+	{
+	public:
+		StackMonotonicArena(size_t block_size = 4096) : MonotonicArena(m_buffer,sizeof(m_buffer),block_size)
+		{}
+
+	private:
+		char m_buffer[SIZE];
+	};
+}
+
+#endif // OOBASE_MONOTONIC_ARENA_H_INCLUDED_
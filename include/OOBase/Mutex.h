@@ -24,6 +24,7 @@
 
 #include "Timeout.h"
 #include "StackAllocator.h"
+#include "Atomic.h"
 #include "Win32.h"
 
 namespace OOBase
@@ -101,6 +102,75 @@ namespace OOBase
 	};
 #endif
 
+	namespace detail
+	{
+		/// Sleep while val == expected, until futex_wake(val) is called or timeout expires
+		/**
+		 *  Returns false only on timeout: like any futex, it may return early and the
+		 *  caller must check val again.  Linux futexes are used where available,
+		 *  otherwise waiters park on a condition variable hashed from the address.
+		 */
+		bool futex_wait(uint32_t& val, uint32_t expected, const Timeout& timeout = Timeout());
+
+		/// Wake one, or all, of the threads sleeping in futex_wait(val)
+		void futex_wake(uint32_t& val, bool all = false);
+
+		/// Tell the CPU we are spinning
+		inline void cpu_pause()
+		{
+#if defined(_WIN32)
+			YieldProcessor();
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+			__asm__ __volatile__("pause");
+#elif defined(__GNUC__) && defined(__aarch64__)
+			__asm__ __volatile__("yield");
+#endif
+		}
+	}
+
+	/// A non-recursive 4-byte mutex that spins briefly before sleeping
+	/**
+	 *  Uncontended, acquire() and release() are a single atomic operation each.
+	 *  Under contention it spins with exponential backoff, then sleeps on a futex
+	 *  until release() wakes it.  It works with Guard<> and Condition::wait().
+	 */
+	class FastMutex : public NonCopyable
+	{
+		friend class Condition;
+
+	public:
+		FastMutex() : m_state(0)
+		{}
+
+		bool try_acquire()
+		{
+			return (Atomic<uint32_t>::CompareAndSwap(m_state,0,1,memory_order_acquire) == 0);
+		}
+
+		void acquire()
+		{
+			if (!try_acquire())
+				acquire_slow(Timeout());
+		}
+
+		bool acquire(const Timeout& timeout)
+		{
+			return (try_acquire() || acquire_slow(timeout));
+		}
+
+		void release()
+		{
+			if (Atomic<uint32_t>::Exchange(m_state,0,memory_order_release) == 2)
+				detail::futex_wake(m_state);
+		}
+
+	private:
+		// 0 when free, 1 when held, 2 when held and there may be sleepers
+		uint32_t m_state;
+
+		bool acquire_slow(const Timeout& timeout);
+	};
+
 	class RWMutex : public NonCopyable
 	{
 	public:
@@ -127,6 +197,54 @@ namespace OOBase
 #endif
 	};
 
+	/// A reader/writer lock for data that is read far more often than it is written
+	/**
+	 *  Readers count themselves in one of a set of cache-line sized slots, picked
+	 *  by hashing the thread id, so concurrent readers on different threads do not
+	 *  share a cache line.  A writer raises a flag that turns new readers away,
+	 *  then waits for every slot to drain.  acquire_read() and release_read() are
+	 *  one uncontended atomic each when there is no writer, but writers are slow.
+	 *  Use it with ReadGuard<> and Guard<> like RWMutex.
+	 */
+	class BigReaderMutex : public NonCopyable
+	{
+	public:
+		BigReaderMutex();
+
+		// Write lock
+		bool try_acquire();
+		void acquire();
+		void release();
+
+		// Read lock
+		bool try_acquire_read();
+		void acquire_read();
+		void release_read();
+
+	private:
+		static const size_t s_slot_bits = 5;
+		static const size_t s_slots = size_t(1) << s_slot_bits;
+
+		struct OOBASE_ALIGNED(OOBASE_CACHE_LINE_SIZE) Slot
+		{
+			uint32_t m_readers;
+			char     m_pad[OOBASE_CACHE_LINE_SIZE - sizeof(uint32_t)];
+		};
+
+		Slot      m_slots[s_slots];
+		FastMutex m_writer_lock;
+
+		// 0 with no writer, 1 with a writer, 2 with a writer and sleeping readers
+		uint32_t  m_writer;
+
+		// Bumped by readers leaving while a writer waits
+		uint32_t  m_drained;
+
+		uint32_t& slot();
+		bool readers_gone();
+		void reader_leave(uint32_t& readers);
+	};
+
 	template <typename MUTEX>
 	class Guard : public NonCopyable
 	{
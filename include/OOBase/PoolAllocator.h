@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_POOL_ALLOCATOR_H_INCLUDED_
+#define OOBASE_POOL_ALLOCATOR_H_INCLUDED_
+
+#include "Singleton.h"
+#include "Mutex.h"
+#include "FreeList.h"
+
+namespace OOBase
+{
+	namespace detail
+	{
+		/// A slab allocator of fixed size blocks
+		/**
+		 *  Slabs are carved into a lock-free FreeList shared by every thread, so
+		 *  allocate() and free() are O(1), and only growing the pool takes a lock.
+		 *  With magazines enabled each thread keeps a small stack of blocks of its
+		 *  own, and only touches the shared list to refill or flush it.  A pool with
+		 *  magazines must outlive any thread that has used it.
+		 */
+		class FixedPool : public NonCopyable
+		{
+		public:
+			FixedPool(size_t size, size_t align, bool magazines);
+			~FixedPool();
+
+			size_t block_size() const
+			{
+				return m_size;
+			}
+
+			void* allocate();
+			void free(void* ptr);
+
+		private:
+			struct Magazine;
+
+			size_t    m_size;
+			size_t    m_align;
+			size_t    m_per_slab;
+			bool      m_magazines;
+			SpinLock  m_lock;
+			FreeList  m_free;
+			void*     m_slabs;
+			Magazine* m_mags;
+
+			void* central_allocate();
+			void central_free(void* ptr);
+			bool grow();
+
+			Magazine* magazine();
+			void attach(Magazine* mag);
+			void detach(Magazine* mag);
+			static void destroy_magazine(void* p);
+		};
+	}
+
+	/// A static allocator of blocks of at most SIZE bytes, aligned to at most ALIGN
+	/**
+	 *  Intended for containers that allocate many same-sized nodes, e.g.
+	 *  List<T,PoolAllocator<sizeof(T) + 2*sizeof(void*)> >.  Requests larger
+	 *  than SIZE, or more strictly aligned than ALIGN, fail.
+	 */
+	template <size_t SIZE, size_t ALIGN = 16, bool MAGAZINES = false>
+	class PoolAllocator : public AllocateNewStatic<PoolAllocator<SIZE,ALIGN,MAGAZINES> >
+	{
+	public:
+		static void* allocate(size_t bytes, size_t align = ALIGN)
+		{
+			if (bytes > SIZE || align > ALIGN)
+				return NULL;
+
+			return Singleton<Pool>::instance().allocate();
+		}
+
+		static void* reallocate(void* ptr, size_t bytes, size_t align = ALIGN)
+		{
+			if (!ptr)
+				return allocate(bytes,align);
+
+			if (!bytes)
+			{
+				free(ptr);
+				return NULL;
+			}
+
+			// Every block is already as big as it can be
+			return (bytes <= SIZE && align <= ALIGN) ? ptr : NULL;
+		}
+
+		static void free(void* ptr)
+		{
+			if (ptr)
+				Singleton<Pool>::instance().free(ptr);
+		}
+
+	private:
+		struct Pool : public detail::FixedPool
+		{
+			Pool() : detail::FixedPool(SIZE,ALIGN,MAGAZINES)
+			{}
+		};
+	};
+
+	/// The AllocatorInstance equivalent of PoolAllocator, with the block size chosen at runtime
+	class PoolAllocatorInstance : public AllocatorInstance
+	{
+	public:
+		PoolAllocatorInstance(size_t size, size_t align = 16, bool magazines = false);
+
+		void* allocate(size_t bytes, size_t align);
+		void* reallocate(void* ptr, size_t bytes, size_t align);
+		void free(void* ptr);
+
+	private:
+		size_t            m_align;
+		detail::FixedPool m_pool;
+	};
+}
+
+#endif // OOBASE_POOL_ALLOCATOR_H_INCLUDED_
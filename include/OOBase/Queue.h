@@ -162,6 +162,20 @@ namespace OOBase
 				return true;
 			}
 
+			bool pop_back(T* value = NULL)
+			{
+				if (this->m_front == this->m_back)
+					return false;
+
+				this->m_back = (this->m_back + this->m_capacity - 1) % this->m_capacity;
+
+				if (value)
+					*value = this->m_data[this->m_back];
+
+				this->m_data[this->m_back].~T();
+				return true;
+			}
+
 		protected:
 			bool grow()
 			{
@@ -261,6 +275,19 @@ namespace OOBase
 				return true;
 			}
 
+			bool pop_back(T* value = NULL)
+			{
+				if (this->m_front == this->m_back)
+					return false;
+
+				this->m_back = (this->m_back + this->m_capacity - 1) % this->m_capacity;
+
+				if (value)
+					*value = this->m_data[this->m_back];
+
+				return true;
+			}
+
 		protected:
 			bool grow()
 			{
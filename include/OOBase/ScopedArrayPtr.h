@@ -23,6 +23,7 @@
 #define OOBASE_SCOPED_ARRAY_PTR_H_INCLUDED_
 
 #include "Vector.h"
+#include "AllocatorStats.h"
 
 namespace OOBase
 {
@@ -55,8 +56,14 @@ namespace OOBase
 		{
 			if (m_data == m_static)
 			{
+#if defined(OOBASE_ALLOC_STATS)
+				s_stats.requested(count * sizeof(T));
+#endif
 				if (count > COUNT)
 				{
+#if defined(OOBASE_ALLOC_STATS)
+					s_stats.overflowed();
+#endif
 					if (!m_dynamic.resize(count))
 						return false;
 
@@ -108,12 +115,36 @@ namespace OOBase
 			return m_dynamic.get_allocator();
 		}
 
+		/// Sizes requested and overflows past COUNT for every ScopedArrayPtr<T,Allocator,COUNT>
+		/**
+		 *  Only collected when built with OOBASE_ALLOC_STATS.
+		 */
+		static bool get_stats(AllocatorStats& stats)
+		{
+#if defined(OOBASE_ALLOC_STATS)
+			s_stats.snapshot(stats);
+			return true;
+#else
+			(void)stats;
+			return false;
+#endif
+		}
+
 	private:
 		T           m_static[COUNT];
 		T*          m_data;
 
 		Vector<T,Allocator> m_dynamic;
+
+#if defined(OOBASE_ALLOC_STATS)
+		static detail::AllocatorCounters s_stats;
+#endif
 	};
+
+#if defined(OOBASE_ALLOC_STATS)
+	template <typename T, typename Allocator, size_t COUNT>
+	detail::AllocatorCounters ScopedArrayPtr<T,Allocator,COUNT>::s_stats;
+#endif
 }
 
 #endif // OOBASE_SCOPED_ARRAY_PTR_H_INCLUDED_
@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_SEQ_LOCK_H_INCLUDED_
+#define OOBASE_SEQ_LOCK_H_INCLUDED_
+
+#include "Mutex.h"
+
+namespace OOBase
+{
+	/// A small value with lock-free readers that never write to shared memory
+	/**
+	 *  Readers copy the value out optimistically and retry if a writer changed it
+	 *  meanwhile, so T must be safe to copy with memcpy() and cheap to copy twice.
+	 *  Writers are serialised by a SpinLock: hold a Guard<SeqLock<T> > and change
+	 *  value(), or just call store().
+	 */
+	template <typename T>
+	class SeqLock : public NonCopyable
+	{
+	public:
+		SeqLock() : m_seq(0), m_val()
+		{}
+
+		SeqLock(typename call_traits<T>::param_type v) : m_seq(0), m_val(v)
+		{}
+
+		/// Copy out a consistent snapshot of the value
+		void load(T& v) const
+		{
+			for (;;)
+			{
+				size_t seq = Atomic<size_t>::Load(m_seq,memory_order_acquire);
+				if (!(seq & 1))
+				{
+					memcpy(static_cast<void*>(&v),static_cast<const void*>(&m_val),sizeof(T));
+
+					// Make sure the copy is complete before checking nothing changed under it
+					detail::atomic_thread_fence(memory_order_acquire);
+					if (Atomic<size_t>::Load(m_seq,memory_order_relaxed) == seq)
+						return;
+				}
+
+				detail::cpu_pause();
+			}
+		}
+
+		T load() const
+		{
+			T v;
+			load(v);
+			return v;
+		}
+
+		void store(typename call_traits<T>::param_type v)
+		{
+			Guard<SeqLock> guard(*this);
+			m_val = v;
+		}
+
+		// Writer lock
+		bool try_acquire()
+		{
+			if (!m_lock.try_acquire())
+				return false;
+
+			begin_write();
+			return true;
+		}
+
+		void acquire()
+		{
+			m_lock.acquire();
+			begin_write();
+		}
+
+		void release()
+		{
+			Atomic<size_t>::Store(m_seq,m_seq + 1,memory_order_release);
+			m_lock.release();
+		}
+
+		/// The value itself, only to be used while holding the writer lock
+		T& value()
+		{
+			return m_val;
+		}
+
+	private:
+		// Odd while a writer is busy
+		size_t   m_seq;
+		T        m_val;
+		SpinLock m_lock;
+
+		void begin_write()
+		{
+			// Readers must see the odd count before any change to the value
+			Atomic<size_t>::Store(m_seq,m_seq + 1,memory_order_relaxed);
+			detail::atomic_thread_fence(memory_order_release);
+		}
+	};
+}
+
+#endif // OOBASE_SEQ_LOCK_H_INCLUDED_
@@ -44,28 +44,28 @@ namespace OOBase
 
 			void addref()
 			{
-				++m_ref_count;
+				// A new reference is always copied from an existing one, so nothing needs ordering
+				Atomic<size_t>::Increment(m_ref_count,memory_order_relaxed);
 			}
 
 			bool addref_lock()
 			{
 				// Loop trying to increase m_ref_count unless it is 0
-				for (;;)
+				for (size_t t = Atomic<size_t>::Load(m_ref_count,memory_order_relaxed);t != 0;)
 				{
-					size_t t = m_ref_count;
-					if (t == 0)
-						break;
-
-					m_ref_count.CompareAndSwap(t,t+1);
-					if (m_ref_count == t+1)
+					size_t prev = Atomic<size_t>::CompareAndSwap(m_ref_count,t,t+1,memory_order_relaxed);
+					if (prev == t)
 						return true;
+
+					t = prev;
 				}
 				return false;
 			}
 
 			void release()
 			{
-				if (--m_ref_count == 0)
+				// Every release must happen-before the dispose() by the last one
+				if (Atomic<size_t>::Decrement(m_ref_count,memory_order_acq_rel) == 0)
 				{
 					dispose();
 					weak_release();
@@ -74,18 +74,18 @@ namespace OOBase
 
 			void weak_addref()
 			{
-				++m_weak_count;
+				Atomic<size_t>::Increment(m_weak_count,memory_order_relaxed);
 			}
 
 			void weak_release()
 			{
-				if (--m_weak_count == 0)
+				if (Atomic<size_t>::Decrement(m_weak_count,memory_order_acq_rel) == 0)
 					destroy();
 			}
 
 			size_t use_count() const
 			{
-				return m_ref_count;
+				return Atomic<size_t>::Load(m_ref_count,memory_order_relaxed);
 			}
 
 		protected:
@@ -93,8 +93,8 @@ namespace OOBase
 			virtual void destroy() = 0;
 
 		private:
-			Atomic<size_t> m_ref_count;  ///< Number of hard references
-			Atomic<size_t> m_weak_count; ///< Number of weak references + (m_ref_count > 0)
+			size_t m_ref_count;  ///< Number of hard references
+			size_t m_weak_count; ///< Number of weak references + (m_ref_count > 0)
 		};
 
 		template <typename T, typename Allocator>
@@ -143,6 +143,82 @@ namespace OOBase
 			T*                 m_ptr;
 		};
 
+		/// A control block with the object it counts constructed directly after it, in the same allocation
+		template <typename T, typename Derived>
+		class SharedCountInlineBase : public SharedCountBase
+		{
+		public:
+			T* object()
+			{
+				return reinterpret_cast<T*>(reinterpret_cast<char*>(static_cast<Derived*>(this)) + offset());
+			}
+
+			virtual void dispose()
+			{
+				object()->~T();
+			}
+
+		protected:
+			static size_t offset()
+			{
+				return (sizeof(Derived) + alignment_of<T>::value - 1) & ~(alignment_of<T>::value - 1);
+			}
+
+			static size_t size()
+			{
+				return offset() + sizeof(T);
+			}
+
+			static size_t align()
+			{
+				return alignment_of<T>::value > alignment_of<Derived>::value ? alignment_of<T>::value : alignment_of<Derived>::value;
+			}
+		};
+
+		template <typename T, typename Allocator>
+		class SharedCountInlineStatic : public SharedCountInlineBase<T,SharedCountInlineStatic<T,Allocator> >
+		{
+			typedef SharedCountInlineBase<T,SharedCountInlineStatic<T,Allocator> > baseClass;
+
+		public:
+			/// Allocate a block for both, but construct only the count: the caller constructs object()
+			static SharedCountInlineStatic* create()
+			{
+				void* p = Allocator::allocate(baseClass::size(),baseClass::align());
+				return p ? ::new (p) SharedCountInlineStatic() : NULL;
+			}
+
+			virtual void destroy()
+			{
+				Allocator::delete_free(this);
+			}
+		};
+
+		template <typename T>
+		class SharedCountInlineInstance : public SharedCountInlineBase<T,SharedCountInlineInstance<T> >
+		{
+			typedef SharedCountInlineBase<T,SharedCountInlineInstance<T> > baseClass;
+
+		public:
+			static SharedCountInlineInstance* create(AllocatorInstance& alloc)
+			{
+				void* p = alloc.allocate(baseClass::size(),baseClass::align());
+				return p ? ::new (p) SharedCountInlineInstance(alloc) : NULL;
+			}
+
+			virtual void destroy()
+			{
+				AllocatorInstance& a = m_alloc;
+				a.delete_free(this);
+			}
+
+		private:
+			SharedCountInlineInstance(AllocatorInstance& alloc) : m_alloc(alloc)
+			{}
+
+			AllocatorInstance& m_alloc;
+		};
+
 		class WeakCount;
 
 		class SharedCount
@@ -928,12 +1004,287 @@ namespace OOBase
 		return detail::shared::template_friend::make_shared(p,b);
 	}
 
+	namespace detail
+	{
+		namespace shared
+		{
+			/// Constructs a T in the block allocated with its inline count c, befriend this for a private constructor
+			class InlineConstruct
+			{
+			public:
+				template <typename T, typename C>
+				static SharedPtr<T> construct(C* c)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4345)
+#endif
+						p = ::new (c->object()) T();
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+
+				template <typename T, typename C, typename P1>
+				static SharedPtr<T> construct(C* c, P1 p1)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+						p = ::new (c->object()) T(p1);
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+
+				template <typename T, typename C, typename P1, typename P2>
+				static SharedPtr<T> construct(C* c, P1 p1, P2 p2)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+						p = ::new (c->object()) T(p1,p2);
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+
+				template <typename T, typename C, typename P1, typename P2, typename P3>
+				static SharedPtr<T> construct(C* c, P1 p1, P2 p2, P3 p3)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+						p = ::new (c->object()) T(p1,p2,p3);
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+
+				template <typename T, typename C, typename P1, typename P2, typename P3, typename P4>
+				static SharedPtr<T> construct(C* c, P1 p1, P2 p2, P3 p3, P4 p4)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+						p = ::new (c->object()) T(p1,p2,p3,p4);
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+
+				template <typename T, typename C, typename P1, typename P2, typename P3, typename P4, typename P5>
+				static SharedPtr<T> construct(C* c, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+						p = ::new (c->object()) T(p1,p2,p3,p4,p5);
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+
+				template <typename T, typename C, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6>
+				static SharedPtr<T> construct(C* c, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+						p = ::new (c->object()) T(p1,p2,p3,p4,p5,p6);
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+
+				template <typename T, typename C, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7>
+				static SharedPtr<T> construct(C* c, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+						p = ::new (c->object()) T(p1,p2,p3,p4,p5,p6,p7);
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+
+				template <typename T, typename C, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8>
+				static SharedPtr<T> construct(C* c, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7, P8 p8)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+						p = ::new (c->object()) T(p1,p2,p3,p4,p5,p6,p7,p8);
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+
+				template <typename T, typename C, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8, typename P9>
+				static SharedPtr<T> construct(C* c, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7, P8 p8, P9 p9)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+						p = ::new (c->object()) T(p1,p2,p3,p4,p5,p6,p7,p8,p9);
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+
+				template <typename T, typename C, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8, typename P9, typename P10>
+				static SharedPtr<T> construct(C* c, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7, P8 p8, P9 p9, P10 p10)
+				{
+					T* p = NULL;
+					if (c)
+					{
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						try {
+#endif
+						p = ::new (c->object()) T(p1,p2,p3,p4,p5,p6,p7,p8,p9,p10);
+#if defined(OOBASE_HAVE_EXCEPTIONS)
+						} catch (...) { c->destroy(); throw; }
+#endif
+					}
+					return make_shared(p,static_cast<SharedCountBase*>(c));
+				}
+			};
+		}
+	}
+
+	/// Construct a T, with its reference counts, in a single allocation from alloc
+	/**
+	 *  The memory is held until the last WeakPtr is released, not just the last SharedPtr.
+	 *  Returns an empty pointer if the allocation fails.
+	 */
+	template <typename T>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc));
+	}
+
+	template <typename T, typename P1>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc, P1 p1)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc),p1);
+	}
+
+	template <typename T, typename P1, typename P2>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc, P1 p1, P2 p2)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc),p1,p2);
+	}
+
+	template <typename T, typename P1, typename P2, typename P3>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc, P1 p1, P2 p2, P3 p3)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc),p1,p2,p3);
+	}
+
+	template <typename T, typename P1, typename P2, typename P3, typename P4>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc, P1 p1, P2 p2, P3 p3, P4 p4)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc),p1,p2,p3,p4);
+	}
+
+	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc),p1,p2,p3,p4,p5);
+	}
+
+	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc),p1,p2,p3,p4,p5,p6);
+	}
+
+	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc),p1,p2,p3,p4,p5,p6,p7);
+	}
+
+	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7, P8 p8)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc),p1,p2,p3,p4,p5,p6,p7,p8);
+	}
+
+	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8, typename P9>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7, P8 p8, P9 p9)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc),p1,p2,p3,p4,p5,p6,p7,p8,p9);
+	}
+
+	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8, typename P9, typename P10>
+	inline SharedPtr<T> allocate_shared_with(AllocatorInstance& alloc, P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7, P8 p8, P9 p9, P10 p10)
+	{
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineInstance<T>::create(alloc),p1,p2,p3,p4,p5,p6,p7,p8,p9,p10);
+	}
+
+	/// Construct a T, with its reference counts, in a single allocation from Allocator
 	template <typename T, typename Allocator>
 	inline SharedPtr<T> allocate_shared()
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create());
 	}
 
 	template <typename T>
@@ -945,9 +1296,7 @@ namespace OOBase
 	template <typename T, typename Allocator, typename P1>
 	inline SharedPtr<T> allocate_shared(P1 p1)
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p,p1);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create(),p1);
 	}
 
 	template <typename T, typename P1>
@@ -959,9 +1308,7 @@ namespace OOBase
 	template <typename T, typename Allocator, typename P1, typename P2>
 	inline SharedPtr<T> allocate_shared(P1 p1, P2 p2)
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p,p1,p2);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create(),p1,p2);
 	}
 
 	template <typename T, typename P1, typename P2>
@@ -973,9 +1320,7 @@ namespace OOBase
 	template <typename T, typename Allocator, typename P1, typename P2, typename P3>
 	inline SharedPtr<T> allocate_shared(P1 p1, P2 p2, P3 p3)
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p,p1,p2,p3);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create(),p1,p2,p3);
 	}
 
 	template <typename T, typename P1, typename P2, typename P3>
@@ -987,9 +1332,7 @@ namespace OOBase
 	template <typename T, typename Allocator, typename P1, typename P2, typename P3, typename P4>
 	inline SharedPtr<T> allocate_shared(P1 p1, P2 p2, P3 p3, P4 p4)
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p,p1,p2,p3,p4);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create(),p1,p2,p3,p4);
 	}
 
 	template <typename T, typename P1, typename P2, typename P3, typename P4>
@@ -1001,9 +1344,7 @@ namespace OOBase
 	template <typename T, typename Allocator, typename P1, typename P2, typename P3, typename P4, typename P5>
 	inline SharedPtr<T> allocate_shared(P1 p1, P2 p2, P3 p3, P4 p4, P5 p5)
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p,p1,p2,p3,p4,p5);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create(),p1,p2,p3,p4,p5);
 	}
 
 	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5>
@@ -1015,9 +1356,7 @@ namespace OOBase
 	template <typename T, typename Allocator, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6>
 	inline SharedPtr<T> allocate_shared(P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6)
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p,p1,p2,p3,p4,p5,p6);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create(),p1,p2,p3,p4,p5,p6);
 	}
 
 	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6>
@@ -1029,9 +1368,7 @@ namespace OOBase
 	template <typename T, typename Allocator, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7>
 	inline SharedPtr<T> allocate_shared(P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7)
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p,p1,p2,p3,p4,p5,p6,p7);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create(),p1,p2,p3,p4,p5,p6,p7);
 	}
 
 	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7>
@@ -1043,9 +1380,7 @@ namespace OOBase
 	template <typename T, typename Allocator, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8>
 	inline SharedPtr<T> allocate_shared(P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7, P8 p8)
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p,p1,p2,p3,p4,p5,p6,p7,p8);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create(),p1,p2,p3,p4,p5,p6,p7,p8);
 	}
 
 	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8>
@@ -1057,9 +1392,7 @@ namespace OOBase
 	template <typename T, typename Allocator, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8, typename P9>
 	inline SharedPtr<T> allocate_shared(P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7, P8 p8, P9 p9)
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p,p1,p2,p3,p4,p5,p6,p7,p8,p9);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create(),p1,p2,p3,p4,p5,p6,p7,p8,p9);
 	}
 
 	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8, typename P9>
@@ -1071,9 +1404,7 @@ namespace OOBase
 	template <typename T, typename Allocator, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8, typename P9, typename P10>
 	inline SharedPtr<T> allocate_shared(P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6, P7 p7, P8 p8, P9 p9, P10 p10)
 	{
-		T* p = NULL;
-		Allocator::allocate_new_ref(p,p1,p2,p3,p4,p5,p6,p7,p8,p9,p10);
-		return make_shared<T,Allocator>(p);
+		return detail::shared::InlineConstruct::construct<T>(detail::SharedCountInlineStatic<T,Allocator>::create(),p1,p2,p3,p4,p5,p6,p7,p8,p9,p10);
 	}
 
 	template <typename T, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6, typename P7, typename P8, typename P9, typename P10>
@@ -23,16 +23,194 @@
 #define OOBASE_SIGNALSLOT_H_INCLUDED_
 
 #include "Delegate.h"
-#include "Vector.h"
+#include "Mutex.h"
+#include "Atomic.h"
+#include "Epoch.h"
 
 namespace OOBase
 {
+	namespace detail
+	{
+		template <typename Allocator>
+		struct SignalSlotsFree
+		{
+			static void* param(const Allocating<Allocator>&)
+			{
+				return NULL;
+			}
+
+			static void free(void* ptr, void*)
+			{
+				Allocator::free(ptr);
+			}
+		};
+
+		template <>
+		struct SignalSlotsFree<AllocatorInstance>
+		{
+			static void* param(const Allocating<AllocatorInstance>& a)
+			{
+				return &a.get_allocator();
+			}
+
+			static void free(void* ptr, void* param)
+			{
+				static_cast<AllocatorInstance*>(param)->free(ptr);
+			}
+		};
+
+		/// A copy-on-write list of delegates, readable without locks or allocation
+		/**
+		 *  connect() and disconnect() build a new immutable list under a mutex and
+		 *  swap it in atomically.  Readers hold an EpochGuard while they call through
+		 *  a list, and a replaced list is retired to the Epoch, so it is freed once
+		 *  the last reader that could have seen it has left.  An AllocatorInstance
+		 *  must therefore outlive the signal until Epoch::collect() has run.
+		 *
+		 *  Slots are called inside that EpochGuard, and nothing retired to the Epoch
+		 *  by any user can be freed until they return.  A slot must not block,
+		 *  wait on another thread, or run for long; hand slow work off elsewhere.
+		 */
+		template <typename Delegate, typename Allocator>
+		class SignalSlots : public NonCopyable, public Allocating<Allocator>
+		{
+			typedef Allocating<Allocator> baseClass;
+
+			struct Slots
+			{
+				size_t   m_count;
+				Delegate m_slots[1];
+			};
+
+		public:
+			SignalSlots() : baseClass(), m_current(NULL)
+			{}
+
+			SignalSlots(AllocatorInstance& a) : baseClass(a), m_current(NULL)
+			{}
+
+			~SignalSlots()
+			{
+				// Lists already retired belong to the Epoch now
+				Slots* slots = m_current;
+				if (slots)
+					destroy_slots(slots,SignalSlotsFree<Allocator>::param(*this));
+			}
+
+			bool connect(const Delegate& d)
+			{
+				if (!d)
+					return false;
+
+				Guard<Mutex> guard(m_lock);
+
+				Slots* old = m_current;
+				size_t count = (old ? old->m_count : 0);
+
+				Slots* slots = new_slots(count + 1);
+				if (!slots)
+					return false;
+
+				for (size_t i = 0;i < count;++i)
+					::new (&slots->m_slots[i]) Delegate(old->m_slots[i]);
+				::new (&slots->m_slots[count]) Delegate(d);
+
+				publish(slots);
+				return true;
+			}
+
+			bool disconnect(const Delegate& d)
+			{
+				Guard<Mutex> guard(m_lock);
+
+				Slots* old = m_current;
+				size_t count = (old ? old->m_count : 0);
+
+				size_t matches = 0;
+				for (size_t i = 0;i < count;++i)
+				{
+					if (old->m_slots[i] == d)
+						++matches;
+				}
+
+				if (!matches)
+					return false;
+
+				Slots* slots = NULL;
+				if (matches < count)
+				{
+					if (!(slots = new_slots(count - matches)))
+						return false;
+
+					for (size_t i = 0,j = 0;i < count;++i)
+					{
+						if (!(old->m_slots[i] == d))
+							::new (&slots->m_slots[j++]) Delegate(old->m_slots[i]);
+					}
+				}
+
+				publish(slots);
+				return true;
+			}
+
+			/// Holds the current list steady while its delegates are called
+			class Snapshot : public NonCopyable
+			{
+			public:
+				Snapshot(const SignalSlots& signal) : m_guard(), m_slots(signal.m_current.load(memory_order_acquire))
+				{}
+
+				size_t size() const
+				{
+					return (m_slots ? m_slots->m_count : 0);
+				}
+
+				const Delegate& operator [](size_t i) const
+				{
+					return m_slots->m_slots[i];
+				}
+
+			private:
+				EpochGuard   m_guard;
+				const Slots* m_slots;
+			};
+
+		private:
+			Mutex          m_lock;
+			Atomic<Slots*> m_current;
+
+			Slots* new_slots(size_t count)
+			{
+				Slots* slots = static_cast<Slots*>(baseClass::allocate(sizeof(Slots) + (count - 1) * sizeof(Delegate),alignment_of<Slots>::value));
+				if (slots)
+					slots->m_count = count;
+				return slots;
+			}
+
+			static void destroy_slots(void* ptr, void* param)
+			{
+				Slots* slots = static_cast<Slots*>(ptr);
+				for (size_t i = 0;i < slots->m_count;++i)
+					slots->m_slots[i].~Delegate();
+				SignalSlotsFree<Allocator>::free(slots,param);
+			}
+
+			void publish(Slots* slots)
+			{
+				// Readers may still be calling through the old list
+				Slots* old = m_current.Exchange(slots);
+				if (old)
+					Epoch::retire(old,&destroy_slots,SignalSlotsFree<Allocator>::param(*this));
+			}
+		};
+	}
+
 	template <typename Allocator = CrtAllocator>
 	class Signal0
 	{
 	private:
 		typedef Delegate0<void,Allocator> delegate_t;
-		mutable Vector<delegate_t,Allocator> m_slots;
+		detail::SignalSlots<delegate_t,Allocator> m_slots;
 
 	public:
 		Signal0()
@@ -44,30 +222,30 @@ namespace OOBase
 		template <typename T>
 		bool connect(T* p, void (T::*slot)())
 		{
-			return m_slots.push_back(delegate_t(p,slot));
+			return m_slots.connect(delegate_t(p,slot));
 		}
 
 		bool connect(void (*slot)())
 		{
-			return m_slots.push_back(delegate_t(slot));
+			return m_slots.connect(delegate_t(slot));
 		}
 
 		template <typename T>
 		bool disconnect(T* p, void (T::*slot)())
 		{
-			return m_slots.erase(delegate_t(p,slot));
+			return m_slots.disconnect(delegate_t(p,slot));
+		}
+
+		bool disconnect(void (*slot)())
+		{
+			return m_slots.disconnect(delegate_t(slot));
 		}
 
 		void fire() const
 		{
-			Vector<delegate_t,Allocator> slots(m_slots);
-			for (typename Vector<delegate_t,Allocator>::iterator i=slots.begin();i;++i)
-			{
-				if (!*i)
-					m_slots.erase(*i);
-				else
-					i->invoke();
-			}
+			typename detail::SignalSlots<delegate_t,Allocator>::Snapshot slots(m_slots);
+			for (size_t i = 0;i < slots.size();++i)
+				slots[i].invoke();
 		}
 	};
 
@@ -76,7 +254,7 @@ namespace OOBase
 	{
 	private:
 		typedef Delegate1<void,P1,Allocator> delegate_t;
-		mutable Vector<delegate_t,Allocator> m_slots;
+		detail::SignalSlots<delegate_t,Allocator> m_slots;
 
 	public:
 		Signal1()
@@ -88,30 +266,30 @@ namespace OOBase
 		template <typename T>
 		bool connect(T* p, void (T::*slot)(P1))
 		{
-			return m_slots.push_back(delegate_t(p,slot));
+			return m_slots.connect(delegate_t(p,slot));
 		}
 
 		bool connect(void (*slot)(P1))
 		{
-			return m_slots.push_back(delegate_t(slot));
+			return m_slots.connect(delegate_t(slot));
 		}
 
 		template <typename T>
 		bool disconnect(T* p, void (T::*slot)(P1))
 		{
-			return m_slots.remove(delegate_t(p,slot));
+			return m_slots.disconnect(delegate_t(p,slot));
+		}
+
+		bool disconnect(void (*slot)(P1))
+		{
+			return m_slots.disconnect(delegate_t(slot));
 		}
 
 		void fire(typename call_traits<P1>::param_type p1) const
 		{
-			Vector<delegate_t,Allocator> slots(m_slots);
-			for (typename Vector<delegate_t,Allocator>::iterator i=slots.begin();i;++i)
-			{
-				if (!*i)
-					m_slots.erase(*i);
-				else
-					i->invoke(p1);
-			}
+			typename detail::SignalSlots<delegate_t,Allocator>::Snapshot slots(m_slots);
+			for (size_t i = 0;i < slots.size();++i)
+				slots[i].invoke(p1);
 		}
 	};
 
@@ -120,7 +298,7 @@ namespace OOBase
 	{
 	private:
 		typedef Delegate2<void,P1,P2,Allocator> delegate_t;
-		mutable Vector<delegate_t,Allocator> m_slots;
+		detail::SignalSlots<delegate_t,Allocator> m_slots;
 
 	public:
 		Signal2()
@@ -132,30 +310,30 @@ namespace OOBase
 		template <typename T>
 		bool connect(T* p, void (T::*slot)(P1,P2))
 		{
-			return m_slots.push_back(delegate_t(p,slot));
+			return m_slots.connect(delegate_t(p,slot));
 		}
 
 		bool connect(void (*slot)(P1,P2))
 		{
-			return m_slots.push_back(delegate_t(slot));
+			return m_slots.connect(delegate_t(slot));
 		}
 
 		template <typename T>
 		bool disconnect(T* p, void (T::*slot)(P1,P2))
 		{
-			return m_slots.remove(delegate_t(p,slot));
+			return m_slots.disconnect(delegate_t(p,slot));
+		}
+
+		bool disconnect(void (*slot)(P1,P2))
+		{
+			return m_slots.disconnect(delegate_t(slot));
 		}
 
 		void fire(typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2) const
 		{
-			Vector<delegate_t,Allocator> slots(m_slots);
-			for (typename Vector<delegate_t,Allocator>::iterator i=slots.begin();i;++i)
-			{
-				if (!*i)
-					m_slots.erase(*i);
-				else
-					i->invoke(p1,p2);
-			}
+			typename detail::SignalSlots<delegate_t,Allocator>::Snapshot slots(m_slots);
+			for (size_t i = 0;i < slots.size();++i)
+				slots[i].invoke(p1,p2);
 		}
 	};
 
@@ -164,7 +342,7 @@ namespace OOBase
 	{
 	private:
 		typedef Delegate3<void,P1,P2,P3,Allocator> delegate_t;
-		mutable Vector<delegate_t,Allocator> m_slots;
+		detail::SignalSlots<delegate_t,Allocator> m_slots;
 
 	public:
 		Signal3()
@@ -176,30 +354,30 @@ namespace OOBase
 		template <typename T>
 		bool connect(T* p, void (T::*slot)(P1,P2,P3))
 		{
-			return m_slots.push_back(delegate_t(p,slot));
+			return m_slots.connect(delegate_t(p,slot));
 		}
 
 		bool connect(void (*slot)(P1,P2,P3))
 		{
-			return m_slots.push_back(delegate_t(slot));
+			return m_slots.connect(delegate_t(slot));
 		}
 
 		template <typename T>
 		bool disconnect(T* p, void (T::*slot)(P1,P2,P3))
 		{
-			return m_slots.remove(delegate_t(p,slot));
+			return m_slots.disconnect(delegate_t(p,slot));
+		}
+
+		bool disconnect(void (*slot)(P1,P2,P3))
+		{
+			return m_slots.disconnect(delegate_t(slot));
 		}
 
 		void fire(typename call_traits<P1>::param_type p1, typename call_traits<P2>::param_type p2, typename call_traits<P3>::param_type p3) const
 		{
-			Vector<delegate_t,Allocator> slots(m_slots);
-			for (typename Vector<delegate_t,Allocator>::iterator i=slots.begin();i;++i)
-			{
-				if (!*i)
-					m_slots.erase(*i);
-				else
-					i->invoke(p1,p2,p3);
-			}
+			typename detail::SignalSlots<delegate_t,Allocator>::Snapshot slots(m_slots);
+			for (size_t i = 0;i < slots.size();++i)
+				slots[i].invoke(p1,p2,p3);
 		}
 	};
 }
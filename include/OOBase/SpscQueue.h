@@ -0,0 +1,210 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_SPSC_QUEUE_H_INCLUDED_
+#define OOBASE_SPSC_QUEUE_H_INCLUDED_
+
+#include "Memory.h"
+#include "Atomic.h"
+
+namespace OOBase
+{
+	/// A wait-free single-producer, single-consumer ring buffer
+	/**
+	 *  Exactly one thread may call push() and push_n(), and exactly one other
+	 *  thread may call pop() and pop_n().  N must be a power of two.
+	 *
+	 *  Each side keeps its own index and a private copy of the other side's
+	 *  index on its own cache line, so the shared indices are only re-read
+	 *  when the ring appears full or empty.
+	 */
+	template <typename T, size_t N, typename Allocator = CrtAllocator>
+	class SpscQueue : public Allocating<Allocator>, public NonCopyable
+	{
+		typedef Allocating<Allocator> baseClass;
+
+	public:
+		SpscQueue() : baseClass()
+		{
+			init();
+		}
+
+		SpscQueue(AllocatorInstance& allocator) : baseClass(allocator)
+		{
+			init();
+		}
+
+		~SpscQueue()
+		{
+			if (m_data)
+			{
+				for (;m_head != m_tail;++m_head)
+					m_data[m_head & (N-1)].~T();
+
+				baseClass::free(m_data);
+			}
+		}
+
+		bool errored() const
+		{
+			return (m_data == NULL);
+		}
+
+		size_t capacity() const
+		{
+			return N;
+		}
+
+		bool push(typename call_traits<T>::param_type val)
+		{
+			if (!m_data)
+				return false;
+
+			size_t tail = m_tail;
+			if (tail - m_head_cache == N)
+			{
+				m_head_cache = acquire(m_head);
+				if (tail - m_head_cache == N)
+					return false;
+			}
+
+			::new (&m_data[tail & (N-1)]) T(val);
+
+			release(m_tail,tail + 1);
+			return true;
+		}
+
+		/// Push up to count items, returning the number actually pushed
+		size_t push_n(const T* vals, size_t count)
+		{
+			if (!m_data)
+				return 0;
+
+			size_t tail = m_tail;
+			if (N - (tail - m_head_cache) < count)
+				m_head_cache = acquire(m_head);
+
+			size_t space = N - (tail - m_head_cache);
+			if (count > space)
+				count = space;
+
+			for (size_t i=0;i<count;++i)
+				::new (&m_data[(tail + i) & (N-1)]) T(vals[i]);
+
+			if (count)
+				release(m_tail,tail + count);
+
+			return count;
+		}
+
+		bool pop(T* value = NULL)
+		{
+			size_t head = m_head;
+			if (head == m_tail_cache)
+			{
+				m_tail_cache = acquire(m_tail);
+				if (head == m_tail_cache)
+					return false;
+			}
+
+			T& v = m_data[head & (N-1)];
+			if (value)
+				*value = v;
+			v.~T();
+
+			release(m_head,head + 1);
+			return true;
+		}
+
+		/// Pop up to count items into vals, returning the number actually popped
+		size_t pop_n(T* vals, size_t count)
+		{
+			size_t head = m_head;
+			if (m_tail_cache - head < count)
+				m_tail_cache = acquire(m_tail);
+
+			size_t avail = m_tail_cache - head;
+			if (count > avail)
+				count = avail;
+
+			for (size_t i=0;i<count;++i)
+			{
+				T& v = m_data[(head + i) & (N-1)];
+				vals[i] = v;
+				v.~T();
+			}
+
+			if (count)
+				release(m_head,head + count);
+
+			return count;
+		}
+
+		bool empty() const
+		{
+			return (acquire(m_head) == acquire(m_tail));
+		}
+
+		/// The number of queued items, which may be stale by the time it is returned
+		size_t size() const
+		{
+			size_t head = acquire(m_head);
+			return acquire(m_tail) - head;
+		}
+
+	private:
+		// Producer line: written by push(), read by pop()
+		char   m_pad0[OOBASE_CACHE_LINE_SIZE];
+		size_t m_tail;
+		size_t m_head_cache;
+		char   m_pad1[OOBASE_CACHE_LINE_SIZE - 2*sizeof(size_t)];
+
+		// Consumer line: written by pop(), read by push()
+		size_t m_head;
+		size_t m_tail_cache;
+		char   m_pad2[OOBASE_CACHE_LINE_SIZE - 2*sizeof(size_t)];
+
+		T*     m_data;
+
+		void init()
+		{
+			static_assert(N >= 2 && (N & (N-1)) == 0,"N must be a power of two");
+
+			m_tail = 0;
+			m_head_cache = 0;
+			m_head = 0;
+			m_tail_cache = 0;
+			m_data = static_cast<T*>(baseClass::allocate(N*sizeof(T),alignment_of<T>::value));
+		}
+
+		static size_t acquire(const size_t& idx)
+		{
+			return Atomic<size_t>::Load(idx,memory_order_acquire);
+		}
+
+		static void release(size_t& idx, size_t v)
+		{
+			Atomic<size_t>::Store(idx,v,memory_order_release);
+		}
+	};
+}
+
+#endif // OOBASE_SPSC_QUEUE_H_INCLUDED_
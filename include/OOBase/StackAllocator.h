@@ -22,7 +22,7 @@
 #ifndef OOBASE_STACK_ALLOCATOR_H_INCLUDED_
 #define OOBASE_STACK_ALLOCATOR_H_INCLUDED_
 
-#include "Memory.h"
+#include "AllocatorStats.h"
 
 //#define OOBASE_STACK_ALLOC_CHECK 1
 
@@ -97,10 +97,16 @@ namespace OOBase
 
 		void* allocate(size_t bytes, size_t align)
 		{
+#if defined(OOBASE_ALLOC_STATS)
+			s_stats.requested(bytes);
+#endif
 			void* p = ScratchAllocator::allocate(bytes,align);
 			if (p)
 				return p;
 
+#if defined(OOBASE_ALLOC_STATS)
+			s_stats.overflowed();
+#endif
 			return baseClass::allocate(bytes,align);
 		}
 
@@ -126,9 +132,39 @@ namespace OOBase
 				ScratchAllocator::free(ptr);
 		}
 
+		bool get_stats(AllocatorStats& stats) const
+		{
+			return get_type_stats(stats);
+		}
+
+		/// Requests and overflows to the heap for every StackAllocator<SIZE,Allocator>
+		/**
+		 *  Only collected when built with OOBASE_ALLOC_STATS, the request size
+		 *  histogram and overflow count are intended to help choose SIZE.
+		 */
+		static bool get_type_stats(AllocatorStats& stats)
+		{
+#if defined(OOBASE_ALLOC_STATS)
+			s_stats.snapshot(stats);
+			return true;
+#else
+			(void)stats;
+			return false;
+#endif
+		}
+
 	private:
 		char m_buffer[((SIZE / sizeof(index_t))+(SIZE % sizeof(index_t) ? 1 : 0)) * sizeof(index_t)];
+
+#if defined(OOBASE_ALLOC_STATS)
+		static detail::AllocatorCounters s_stats;
+#endif
 	};
+
+#if defined(OOBASE_ALLOC_STATS)
+	template <size_t SIZE, typename Allocator>
+	detail::AllocatorCounters StackAllocator<SIZE,Allocator>::s_stats;
+#endif
 }
 
 #endif // OOBASE_STACK_ALLOCATOR_H_INCLUDED_
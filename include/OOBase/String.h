@@ -28,6 +28,7 @@
 #include "SharedPtr.h"
 #include "tr24731.h"
 #include "Win32.h"
+#include "FastHash.h"
 
 #include <string.h>
 
@@ -82,10 +83,10 @@ namespace OOBase
 	public:
 		static const size_t npos = size_t(-1);
 
-		ScopedStringImpl() : m_data(), m_len(0)
+		ScopedStringImpl() : m_data(), m_len(0), m_hash(0)
 		{}
 
-		ScopedStringImpl(AllocatorInstance& allocator) : m_data(allocator), m_len(0)
+		ScopedStringImpl(AllocatorInstance& allocator) : m_data(allocator), m_len(0), m_hash(0)
 		{}
 
 		int compare(const char* rhs) const
@@ -122,6 +123,7 @@ namespace OOBase
 
 			m_data[len] = '\0';
 			m_len = len;
+			reset_hash();
 			return true;
 		}
 
@@ -139,6 +141,7 @@ namespace OOBase
 				memcpy(m_data.get() + orig_len,sz,len);
 				m_data[orig_len + len] = '\0';
 				m_len += len;
+				reset_hash();
 			}
 			return true;
 		}
@@ -153,12 +156,21 @@ namespace OOBase
 			return m_len ? m_data.get() : NULL;
 		}
 
-		char& operator [](ptrdiff_t i) const
+		char operator [](ptrdiff_t i) const
 		{
 			assert(i >= 0 && size_t(i) < m_len);
 			return m_data[i];
 		}
 
+		char& operator [](ptrdiff_t i)
+		{
+			assert(i >= 0 && size_t(i) < m_len);
+
+			// The caller may write through the result
+			reset_hash();
+			return m_data[i];
+		}
+
 		bool empty() const
 		{
 			return (m_len == 0);
@@ -167,6 +179,7 @@ namespace OOBase
 		void clear()
 		{
 			m_len = 0;
+			reset_hash();
 		}
 
 		size_t length() const
@@ -174,6 +187,22 @@ namespace OOBase
 			return m_len;
 		}
 
+		/// The FastHash of the string, calculated on first use and cached until the string changes
+		/**
+		 *  The non-const operator [] resets the cache, so do not keep the returned reference across a call to hash().
+		 */
+		size_t hash() const
+		{
+			// Racing threads will all store the same value
+			size_t h = Atomic<size_t>::Load(m_hash,memory_order_relaxed);
+			if (!h)
+			{
+				h = detail::fast_hash(m_data.get(),m_len);
+				Atomic<size_t>::Store(m_hash,h,memory_order_relaxed);
+			}
+			return h;
+		}
+
 		size_t find(char c, size_t start = 0) const
 		{
 			if (!m_len)
@@ -214,7 +243,10 @@ namespace OOBase
 		{
 			int err = OOBase::vprintf(m_data,format,args);
 			if (!err)
+			{
 				m_len = strlen(m_data.get());
+				reset_hash();
+			}
 			return err;
 		}
 
@@ -228,7 +260,10 @@ namespace OOBase
 		{
 			int err = Win32::wchar_t_to_utf8(wsz,m_data);
 			if (!err)
+			{
 				m_len = strlen(m_data.get());
+				reset_hash();
+			}
 			return err;
 		}
 #endif
@@ -248,6 +283,12 @@ namespace OOBase
 	private:
 		ScopedArrayPtr<char,Allocator,24> m_data;
 		size_t                            m_len;
+		mutable size_t                    m_hash;
+
+		void reset_hash() const
+		{
+			Atomic<size_t>::Store(m_hash,0,memory_order_relaxed);
+		}
 	};
 
 	template<typename A1, typename T>
@@ -395,7 +436,11 @@ namespace OOBase
 
 		char operator [](ptrdiff_t i) const
 		{
-			return !m_ptr ? 0 : m_ptr->operator [](i);
+			if (!m_ptr)
+				return 0;
+
+			assert(i >= 0 && size_t(i) < m_ptr->length());
+			return m_ptr->c_str()[i];
 		}
 
 		bool empty() const
@@ -413,6 +458,12 @@ namespace OOBase
 			return !m_ptr ? 0 : m_ptr->length();
 		}
 
+		/// The FastHash of the string, cached in the shared node so copies hash for free
+		size_t hash() const
+		{
+			return !m_ptr ? detail::fast_hash(NULL,0) : m_ptr->hash();
+		}
+
 		size_t find(char c, size_t start = 0) const
 		{
 			return !m_ptr ? npos : m_ptr->find(c,start);
@@ -534,6 +585,26 @@ namespace OOBase
 		return str1.compare(str2) >= 0;
 	}
 
+	template <typename A>
+	struct FastHash<SharedString<A> >
+	{
+		static size_t hash(const SharedString<A>& v)
+		{
+			return v.hash();
+		}
+
+		template <typename S>
+		static size_t hash(const S& v)
+		{
+			return FastHash<const char*>::hash(v.c_str(),v.length());
+		}
+
+		static size_t hash(const char* c, size_t len = size_t(-1))
+		{
+			return FastHash<const char*>::hash(c,len);
+		}
+	};
+
 	typedef SharedString<CrtAllocator> String;
 
 	typedef ScopedStringImpl<ThreadLocalAllocator> ScopedString;
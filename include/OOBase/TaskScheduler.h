@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OOBASE_TASK_SCHEDULER_H_INCLUDED_
+#define OOBASE_TASK_SCHEDULER_H_INCLUDED_
+
+#include "Thread.h"
+#include "Delegate.h"
+#include "Queue.h"
+#include "Vector.h"
+
+namespace OOBase
+{
+	/// A work-stealing task executor built on a ThreadPool
+	/**
+	 *  Every worker owns a deque of tasks guarded by its own SpinLock.
+	 *  Workers pop their own work LIFO and steal from the front of their
+	 *  siblings' deques when they run dry, so there is no single queue lock.
+	 *  Idle workers park on a Condition until more work is submitted.
+	 */
+	class TaskScheduler : public NonCopyable
+	{
+	public:
+		typedef Delegate0<void,CrtAllocator> task_t;
+
+		TaskScheduler();
+		~TaskScheduler();
+
+		int run(size_t threads);
+		bool submit(const task_t& task);
+		void join();
+		void abort();
+
+		size_t threads() const;
+		size_t pending() const;
+
+	private:
+		struct Worker
+		{
+			SpinLock      m_lock;
+			Queue<task_t> m_tasks;
+		};
+
+		enum State
+		{
+			eClosed = 0,
+			eRunning,
+			eStopping,
+			eAborted
+		};
+
+		ThreadPool             m_pool;
+		Vector<Worker*>        m_workers;
+		Atomic<size_t>         m_next_worker;
+		Atomic<size_t>         m_next_submit;
+		Atomic<size_t>         m_pending;
+		Atomic<size_t>         m_active;
+		Atomic<size_t>         m_sleepers;
+		Atomic<size_t>         m_submitters;
+		Condition::Mutex       m_park_lock;
+		Condition              m_park;
+		Atomic<int>            m_state;
+
+		static int worker_fn(void* param);
+		int worker_run(size_t idx);
+
+		bool push(Worker* worker, const task_t& task);
+		bool pop(size_t idx, task_t& task);
+		bool park();
+		void wake(bool all);
+		void stop(bool abort);
+	};
+}
+
+#endif // OOBASE_TASK_SCHEDULER_H_INCLUDED_
@@ -32,6 +32,7 @@ namespace OOBase
 	class Thread : public NonCopyable, public EnableSharedFromThis<Thread>
 	{
 		friend class AllocateNewStatic<CrtAllocator>;
+		friend class detail::shared::InlineConstruct;
 
 	public:
 		~Thread();
@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "../include/OOBase/AllocatorStats.h"
+
+namespace
+{
+	size_t read(const size_t& v)
+	{
+		return *static_cast<const volatile size_t*>(&v);
+	}
+}
+
+void OOBase::detail::AllocatorCounters::snapshot(AllocatorStats& stats) const
+{
+	// Each counter is read atomically, but the set as a whole may be slightly inconsistent
+	atomic_memory_barrier();
+
+	stats.live_bytes = read(m_live);
+	stats.peak_bytes = read(m_peak);
+	stats.allocations = read(m_allocations);
+	stats.frees = read(m_frees);
+	stats.failures = read(m_failures);
+	stats.overflows = read(m_overflows);
+	for (size_t i=0;i<AllocatorStats::histogram_size;++i)
+		stats.histogram[i] = read(m_histogram[i]);
+}
+
+void OOBase::detail::AllocatorCounters::reset()
+{
+	// Blocks that are still live stay counted
+	size_t live = read(m_live);
+	Atomic<size_t>::Exchange(m_peak,live);
+	Atomic<size_t>::Exchange(m_allocations,0);
+	Atomic<size_t>::Exchange(m_frees,0);
+	Atomic<size_t>::Exchange(m_failures,0);
+	Atomic<size_t>::Exchange(m_overflows,0);
+	for (size_t i=0;i<AllocatorStats::histogram_size;++i)
+		Atomic<size_t>::Exchange(m_histogram[i],0);
+}
+
+OOBase::CountingAllocatorInstance::CountingAllocatorInstance(AllocatorInstance& allocator) :
+		m_allocator(allocator)
+{
+	memset(&m_counters,0,sizeof(m_counters));
+}
+
+void* OOBase::CountingAllocatorInstance::allocate(size_t bytes, size_t align)
+{
+	// The header holds the offset back to the real block, and the requested size
+	size_t offset = (align > 2*sizeof(size_t) ? align : 2*sizeof(size_t));
+	char* p = static_cast<char*>(m_allocator.allocate(offset + bytes,offset));
+	if (!p)
+	{
+		m_counters.failed();
+		return NULL;
+	}
+
+	p += offset;
+	reinterpret_cast<size_t*>(p)[-2] = offset;
+	reinterpret_cast<size_t*>(p)[-1] = bytes;
+	m_counters.allocated(bytes);
+	return p;
+}
+
+void* OOBase::CountingAllocatorInstance::reallocate(void* ptr, size_t bytes, size_t align)
+{
+	if (!ptr)
+		return allocate(bytes,align);
+
+	if (!bytes)
+	{
+		free(ptr);
+		return NULL;
+	}
+
+	size_t old_bytes = static_cast<size_t*>(ptr)[-1];
+	void* p = allocate(bytes,align);
+	if (p)
+	{
+		memcpy(p,ptr,old_bytes < bytes ? old_bytes : bytes);
+		free(ptr);
+	}
+	return p;
+}
+
+void OOBase::CountingAllocatorInstance::free(void* ptr)
+{
+	if (ptr)
+	{
+		m_counters.freed(static_cast<size_t*>(ptr)[-1]);
+		m_allocator.free(static_cast<char*>(ptr) - static_cast<size_t*>(ptr)[-2]);
+	}
+}
+
+bool OOBase::CountingAllocatorInstance::get_stats(AllocatorStats& stats) const
+{
+	m_counters.snapshot(stats);
+	return true;
+}
+
+void OOBase::CountingAllocatorInstance::reset_stats()
+{
+	m_counters.reset();
+}
@@ -52,6 +52,10 @@
 
 OOBase::ArenaAllocator::ArenaAllocator(bool locked) : m_mspace(NULL)
 {
+#if defined(OOBASE_ALLOC_STATS)
+	memset(&m_stats,0,sizeof(m_stats));
+#endif
+
 	m_mspace = create_mspace(0,locked ? 1 : 0);
 	if (!m_mspace)
 		OOBase_CallCriticalFailure("Failed to create dl_malloc mspace");
@@ -65,27 +69,71 @@ OOBase::ArenaAllocator::~ArenaAllocator()
 
 void* OOBase::ArenaAllocator::allocate(size_t bytes, size_t align)
 {
-	return mspace_memalign(m_mspace,align,bytes);
+	void* p = mspace_memalign(m_mspace,align,bytes);
+
+#if defined(OOBASE_ALLOC_STATS)
+	if (p)
+		m_stats.allocated(mspace_usable_size(p));
+	else
+		m_stats.failed();
+#endif
+
+	return p;
 }
 
 void* OOBase::ArenaAllocator::reallocate(void* ptr, size_t bytes, size_t align)
 {
-	if (align <= 8)
-		return mspace_realloc(m_mspace,ptr,bytes);
+	size_t old_bytes = (ptr ? mspace_usable_size(ptr) : 0);
 
-	if (mspace_realloc_in_place(m_mspace,ptr,bytes))
-		return ptr;
+	void* new_ptr = NULL;
+	if (align <= 8)
+		new_ptr = mspace_realloc(m_mspace,ptr,bytes);
+	else if (mspace_realloc_in_place(m_mspace,ptr,bytes))
+		new_ptr = ptr;
+	else
+	{
+		new_ptr = mspace_memalign(m_mspace,align,bytes);
+		if (new_ptr && ptr)
+		{
+			memcpy(new_ptr,ptr,old_bytes < bytes ? old_bytes : bytes);
+			mspace_free(m_mspace,ptr);
+		}
+	}
 
-	void* new_ptr = mspace_memalign(m_mspace,align,bytes);
+#if defined(OOBASE_ALLOC_STATS)
+	// A reallocation counts as a free and an allocation
 	if (new_ptr)
 	{
-		memcpy(new_ptr,ptr,mspace_usable_size(ptr));
-		mspace_free(m_mspace,ptr);
+		if (ptr)
+			m_stats.freed(old_bytes);
+		m_stats.allocated(mspace_usable_size(new_ptr));
 	}
+	else if (bytes)
+		m_stats.failed();
+	else if (ptr)
+		m_stats.freed(old_bytes);
+#endif
+
 	return new_ptr;
 }
 
 void OOBase::ArenaAllocator::free(void* ptr)
 {
+#if defined(OOBASE_ALLOC_STATS)
+	if (ptr)
+		m_stats.freed(mspace_usable_size(ptr));
+#endif
+
 	mspace_free(m_mspace,ptr);
 }
+
+bool OOBase::ArenaAllocator::get_stats(AllocatorStats& stats) const
+{
+#if defined(OOBASE_ALLOC_STATS)
+	m_stats.snapshot(stats);
+	return true;
+#else
+	(void)stats;
+	return false;
+#endif
+}
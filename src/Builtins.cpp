@@ -120,10 +120,10 @@ unsigned int OOBase::detail::ffs(uint16_t v)
 /* Define if you have atomic exchange for 32bit values */
 #define ATOMIC_EXCH_32(t,v) _InterlockedExchange((long volatile*)(t),(long)(v))
 
-/* Define if you have atomic inc and dec for 32bit values */
+/* Define if you have atomic inc and dec for 32bit values, the add returns the new value */
 #define ATOMIC_INC_32(t) _InterlockedIncrement((long volatile*)(t))
 #define ATOMIC_DEC_32(t) _InterlockedDecrement((long volatile*)(t))
-#define ATOMIC_ADD_32(t,v) _InterlockedExchangeAdd((long volatile*)(t),(long)(v))
+#define ATOMIC_ADD_32(t,v) (_InterlockedExchangeAdd((long volatile*)(t),(long)(v)) + (long)(v))
 
 /* Define if you have atomic compare-and-swap for 64bit values */
 #define ATOMIC_CAS_64(t,c,x) _InterlockedCompareExchange64((__int64 volatile*)(t),(__int64)(x),(__int64)(c))
@@ -135,7 +135,7 @@ unsigned int OOBase::detail::ffs(uint16_t v)
 /* Define if you have atomic compare-and-swap for 64bit values */
 #define ATOMIC_INC_64(t) _InterlockedIncrement64((__int64 volatile*)(t))
 #define ATOMIC_DEC_64(t) _InterlockedDecrement64((__int64 volatile*)(t))
-#define ATOMIC_ADD_64(t,v) _InterlockedExchangeAdd64((__int64 volatile*)(t),(__int64)(v))
+#define ATOMIC_ADD_64(t,v) (_InterlockedExchangeAdd64((__int64 volatile*)(t),(__int64)(v)) + (__int64)(v))
 #endif
 
 #elif defined(__clang__)
@@ -207,7 +207,7 @@ unsigned int OOBase::detail::ffs(uint16_t v)
 #endif
 
 #if !defined(ATOMIC_ADD_32)
-#define ATOMIC_ADD_32(t,v) InterlockedExchangeAdd((long volatile*)(t),(long)(v))
+#define ATOMIC_ADD_32(t,v) (InterlockedExchangeAdd((long volatile*)(t),(long)(v)) + (long)(v))
 #endif
 
 #if (_WIN32_WINNT >= 0x0600)
@@ -224,7 +224,7 @@ unsigned int OOBase::detail::ffs(uint16_t v)
 #endif
 
 #if !defined(ATOMIC_ADD_64)
-#define ATOMIC_ADD_64(t,v) InterlockedExchangeAdd64((__int64 volatile*)(t),(__int64)(v))
+#define ATOMIC_ADD_64(t,v) (InterlockedExchangeAdd64((__int64 volatile*)(t),(__int64)(v)) + (__int64)(v))
 #endif
 #endif
 
@@ -362,3 +362,26 @@ OOBase::int64_t OOBase::detail::atomic_dec_8(int64_t volatile* val)
 #endif
 }
 #endif // ATOMIC_CAS_64
+
+namespace
+{
+	// Striped locks for double-word compare-and-swap, where the CPU has none
+	static const size_t s_dword_locks = 16;
+	OOBase::int32_t s_dword_lock[s_dword_locks];
+}
+
+bool OOBase::detail::atomic_cas_dword_locked(AtomicDWord* val, AtomicDWord* expected, const AtomicDWord* desired)
+{
+	int32_t volatile* lock = &s_dword_lock[(reinterpret_cast<size_t>(val) / sizeof(AtomicDWord)) % s_dword_locks];
+	while (atomic_cas_4(lock,0,1) != 0)
+		;
+
+	bool ret = (val->m_lo == expected->m_lo && val->m_hi == expected->m_hi);
+	if (ret)
+		*val = *desired;
+	else
+		*expected = *val;
+
+	atomic_swap_4(lock,0);
+	return ret;
+}
@@ -25,11 +25,40 @@
 void OOBase::Condition::swap(Condition& rhs)
 {
 	OOBase::swap(m_var,rhs.m_var);
+	OOBase::swap(m_seq,rhs.m_seq);
+	OOBase::swap(m_fast_waiters,rhs.m_fast_waiters);
+}
+
+bool OOBase::Condition::wait(FastMutex& mutex, const Timeout& timeout) const
+{
+	// Both are done under the mutex, so a signal after we unlock is bound to see us
+	Atomic<uint32_t>::Increment(m_fast_waiters);
+	uint32_t seq = Atomic<uint32_t>::Load(m_seq);
+
+	mutex.release();
+
+	bool ret = detail::futex_wait(m_seq,seq,timeout);
+
+	mutex.acquire();
+
+	Atomic<uint32_t>::Decrement(m_fast_waiters);
+	return ret;
+}
+
+void OOBase::Condition::wake_fast(bool all)
+{
+	if (Atomic<uint32_t>::Load(m_fast_waiters))
+	{
+		Atomic<uint32_t>::Increment(m_seq);
+		detail::futex_wake(m_seq,all);
+	}
 }
 
 #if defined(_WIN32)
 
-OOBase::Condition::Condition()
+OOBase::Condition::Condition() :
+		m_seq(0),
+		m_fast_waiters(0)
 {
 	Win32::InitializeConditionVariable(&m_var);
 }
@@ -56,16 +85,20 @@ bool OOBase::Condition::wait(Condition::Mutex& mutex, const Timeout& timeout) co
 void OOBase::Condition::signal()
 {
 	Win32::WakeConditionVariable(&m_var);
+	wake_fast(false);
 }
 
 void OOBase::Condition::broadcast()
 {
 	Win32::WakeAllConditionVariable(&m_var);
+	wake_fast(true);
 }
 
 #elif defined(HAVE_PTHREAD)
 
-OOBase::Condition::Condition()
+OOBase::Condition::Condition() :
+		m_seq(0),
+		m_fast_waiters(0)
 {
 	pthread_condattr_t attr;
 	int err = pthread_condattr_init(&attr);
@@ -117,22 +150,22 @@ bool OOBase::Condition::wait(Condition::Mutex& mutex, const Timeout& timeout) co
 void OOBase::Condition::signal()
 {
 	pthread_cond_signal(&m_var);
+	wake_fast(false);
 }
 
 void OOBase::Condition::broadcast()
 {
 	pthread_cond_broadcast(&m_var);
+	wake_fast(true);
 }
 
 #endif
 
-#if defined(_WIN32)
-
 OOBase::Event::Event(bool bSet, bool bAutoReset) :
-		m_handle(::CreateEvent(NULL,bAutoReset ? FALSE : TRUE,bSet ? TRUE : FALSE,NULL))
+		m_state(bSet ? 1 : 0),
+		m_waiters(0),
+		m_bAuto(bAutoReset)
 {
-	if (!m_handle.valid())
-		OOBase_CallCriticalFailure(GetLastError());
 }
 
 OOBase::Event::~Event()
@@ -141,95 +174,189 @@ OOBase::Event::~Event()
 
 bool OOBase::Event::is_set() const
 {
-	return (WaitForSingleObject(m_handle,0) == WAIT_OBJECT_0);
+	// Reset if we are an auto event
+	if (m_bAuto)
+		return (Atomic<uint32_t>::CompareAndSwap(m_state,1,0) == 1);
+
+	return (Atomic<uint32_t>::Load(m_state) == 1);
 }
 
 void OOBase::Event::set()
 {
-	if (!::SetEvent(m_handle))
-		OOBase_CallCriticalFailure(GetLastError());
+	// The store comes before the load of m_waiters, so a waiter we miss here will see it set
+	if (Atomic<uint32_t>::Exchange(m_state,1) == 0 && Atomic<uint32_t>::Load(m_waiters))
+	{
+		// If we are an auto event, wake 1 thread only
+		detail::futex_wake(m_state,!m_bAuto);
+	}
 }
 
 bool OOBase::Event::wait(const Timeout& timeout) const
 {
-	DWORD dwWait = WaitForSingleObject(m_handle,timeout.millisecs());
-	if (dwWait == WAIT_OBJECT_0)
+	if (is_set())
 		return true;
-	else if (dwWait != WAIT_TIMEOUT)
-		OOBase_CallCriticalFailure(GetLastError());
 
-	return false;
+	Atomic<uint32_t>::Increment(m_waiters);
+
+	bool ret = false;
+	for (;;)
+	{
+		if ((ret = is_set()) || !detail::futex_wait(m_state,0,timeout))
+			break;
+	}
+
+	Atomic<uint32_t>::Decrement(m_waiters);
+
+	// It may have been set just as we timed out
+	return (ret || is_set());
 }
 
 void OOBase::Event::reset()
 {
-	if (!::ResetEvent(m_handle))
-		OOBase_CallCriticalFailure(GetLastError());
+	Atomic<uint32_t>::Store(m_state,0);
 }
 
-#else
+OOBase::Semaphore::Semaphore(uint32_t count) :
+		m_count(count),
+		m_waiters(0)
+{
+}
 
-OOBase::Event::Event(bool bSet, bool bAutoReset) :
-		m_bAuto(bAutoReset), m_bSet(bSet)
+bool OOBase::Semaphore::try_acquire()
 {
+	for (uint32_t count = Atomic<uint32_t>::Load(m_count,memory_order_relaxed);count;)
+	{
+		uint32_t prev = Atomic<uint32_t>::CompareAndSwap(m_count,count,count - 1,memory_order_acquire);
+		if (prev == count)
+			return true;
+		count = prev;
+	}
+	return false;
 }
 
-OOBase::Event::~Event()
+void OOBase::Semaphore::acquire()
 {
+	acquire(Timeout());
 }
 
-bool OOBase::Event::is_set() const
+bool OOBase::Semaphore::acquire(const Timeout& timeout)
 {
-	Guard<Condition::Mutex> guard(m_lock);
+	if (try_acquire())
+		return true;
 
-	bool bSet = m_bSet;
+	Atomic<uint32_t>::Increment(m_waiters);
 
-	// Reset if we are an auto event
-	if (bSet && m_bAuto)
-		m_bSet = false;
+	bool ret = false;
+	for (;;)
+	{
+		if ((ret = try_acquire()) || !detail::futex_wait(m_count,0,timeout))
+			break;
+	}
+
+	Atomic<uint32_t>::Decrement(m_waiters);
 
-	return bSet;
+	return (ret || try_acquire());
 }
 
-void OOBase::Event::set()
+void OOBase::Semaphore::release(uint32_t count)
 {
-	Guard<Condition::Mutex> guard(m_lock);
+	Atomic<uint32_t>::Add(m_count,count);
+	if (Atomic<uint32_t>::Load(m_waiters))
+		detail::futex_wake(m_count,count > 1);
+}
 
-	// Only set if we are not set
-	if (!m_bSet)
-	{
-		m_bSet = true;
+OOBase::Latch::Latch(uint32_t count) :
+		m_count(count),
+		m_waiters(0)
+{
+}
 
-		// If we are an auto event, signal 1 thread only
-		if (m_bAuto)
-			m_condition.signal();
-		else
-			m_condition.broadcast();
-	}
+void OOBase::Latch::count_down(uint32_t n)
+{
+	if (Atomic<uint32_t>::Subtract(m_count,n) == 0 && Atomic<uint32_t>::Load(m_waiters))
+		detail::futex_wake(m_count,true);
 }
 
-bool OOBase::Event::wait(const Timeout& timeout) const
+bool OOBase::Latch::is_ready() const
 {
-	Guard<Condition::Mutex> guard(m_lock);
+	return (Atomic<uint32_t>::Load(m_count) == 0);
+}
 
-	while (!m_bSet)
+bool OOBase::Latch::wait(const Timeout& timeout) const
+{
+	uint32_t count = Atomic<uint32_t>::Load(m_count);
+	if (!count)
+		return true;
+
+	Atomic<uint32_t>::Increment(m_waiters);
+
+	while ((count = Atomic<uint32_t>::Load(m_count)) != 0)
 	{
-		if (!m_condition.wait(m_lock,timeout))
-			return false;
+		if (!detail::futex_wait(m_count,count,timeout))
+			break;
 	}
 
-	// Reset if we are an auto event
-	if (m_bAuto)
-		m_bSet = false;
+	Atomic<uint32_t>::Decrement(m_waiters);
 
-	return true;
+	return is_ready();
 }
 
-void OOBase::Event::reset()
+OOBase::Barrier::Barrier(uint32_t count) :
+		m_state(0),
+		m_waiters(0),
+		m_count(count)
 {
-	Guard<Condition::Mutex> guard(m_lock);
-
-	m_bSet = false;
+	assert(count && count <= 0xFFFF);
 }
 
-#endif
+bool OOBase::Barrier::wait(const Timeout& timeout)
+{
+	uint32_t state = Atomic<uint32_t>::Load(m_state);
+	for (;;)
+	{
+		uint32_t arrived = (state & 0xFFFF) + 1;
+
+		// The last to arrive starts the next phase
+		uint32_t next = (arrived == m_count ? (state & 0xFFFF0000) + 0x10000 : state + 1);
+
+		uint32_t prev = Atomic<uint32_t>::CompareAndSwap(m_state,state,next);
+		if (prev == state)
+		{
+			if (arrived < m_count)
+				break;
+
+			if (Atomic<uint32_t>::Load(m_waiters))
+				detail::futex_wake(m_state,true);
+			return true;
+		}
+		state = prev;
+	}
+
+	const uint32_t phase = state & 0xFFFF0000;
+
+	Atomic<uint32_t>::Increment(m_waiters);
+
+	bool ret = true;
+	for (state = Atomic<uint32_t>::Load(m_state);(state & 0xFFFF0000) == phase;state = Atomic<uint32_t>::Load(m_state))
+	{
+		if (!detail::futex_wait(m_state,state,timeout))
+		{
+			// Withdraw, unless the phase completed just now
+			for (state = Atomic<uint32_t>::Load(m_state);(state & 0xFFFF0000) == phase;)
+			{
+				uint32_t prev = Atomic<uint32_t>::CompareAndSwap(m_state,state,state - 1);
+				if (prev == state)
+				{
+					ret = false;
+					break;
+				}
+				state = prev;
+			}
+			break;
+		}
+	}
+
+	Atomic<uint32_t>::Decrement(m_waiters);
+
+	return ret;
+}
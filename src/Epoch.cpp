@@ -0,0 +1,246 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "../include/OOBase/Epoch.h"
+#include "../include/OOBase/TLSSingleton.h"
+#include "../include/OOBase/Atomic.h"
+#include "../include/OOBase/Vector.h"
+
+namespace
+{
+	// Try to move the epoch on after this many retirements
+	static const size_t s_collect_threshold = 64;
+
+	struct Retired
+	{
+		void* m_ptr;
+		void (*m_destroy)(void*,void*);
+		void* m_param;
+	};
+
+	typedef OOBase::Vector<Retired,OOBase::CrtAllocator> limbo_t;
+
+	// One per thread, recycled when the thread exits but never freed, so the registry can be walked without locks
+	struct Record
+	{
+		Record() : m_state(0), m_in_use(1), m_next(NULL), m_nesting(0), m_pending(0)
+		{
+			for (size_t i=0;i<3;++i)
+				m_epochs[i] = 0;
+		}
+
+		// The epoch seen on entry shifted up one bit, with the low bit set while in a critical section
+		OOBase::Atomic<size_t> m_state;
+		OOBase::Atomic<int>    m_in_use;
+		Record*                m_next;
+
+		// Only touched by the thread that has claimed the record
+		size_t  m_nesting;
+		size_t  m_pending;
+
+		// Nodes retired in epoch e wait in m_limbo[e % 3] until the epoch reaches e + 2
+		size_t  m_epochs[3];
+		limbo_t m_limbo[3];
+
+		void add(const Retired& r, size_t epoch);
+		void reclaim(size_t epoch);
+		void free_limbo(size_t i);
+	};
+
+	// Both plain PODs, so they are usable before any constructors have run
+	static size_t  s_epoch = 0;
+	static Record* s_records = NULL;
+
+	// The address is the TLS key
+	static const int s_tls_key = 0;
+
+	size_t try_advance()
+	{
+		size_t epoch = OOBase::Atomic<size_t>::Load(s_epoch);
+		for (Record* r = OOBase::Atomic<Record*>::Load(s_records,OOBase::memory_order_acquire);r;r = r->m_next)
+		{
+			size_t state = r->m_state.load();
+			if ((state & 1) && (state >> 1) != epoch)
+				return epoch;
+		}
+
+		// Every thread in a critical section has seen this epoch, so nothing retired in the last one is reachable
+		size_t prev = OOBase::Atomic<size_t>::CompareAndSwap(s_epoch,epoch,epoch + 1);
+		return (prev == epoch ? epoch + 1 : prev);
+	}
+
+	void Record::add(const Retired& r, size_t epoch)
+	{
+		size_t i = epoch % 3;
+		if (m_epochs[i] != epoch)
+		{
+			// Anything still here is at least 3 epochs old
+			free_limbo(i);
+			m_epochs[i] = epoch;
+		}
+
+		if (!m_limbo[i].push_back(r))
+			OOBase_CallCriticalFailure(ERROR_OUTOFMEMORY);
+
+		++m_pending;
+	}
+
+	void Record::reclaim(size_t epoch)
+	{
+		for (size_t i=0;i<3;++i)
+		{
+			if (m_epochs[i] + 2 <= epoch)
+				free_limbo(i);
+		}
+	}
+
+	void Record::free_limbo(size_t i)
+	{
+		if (m_limbo[i].empty())
+			return;
+
+		// A destructor may well retire something else, so work on a copy of the list
+		limbo_t limbo;
+		limbo.swap(m_limbo[i]);
+		m_pending -= limbo.size();
+
+		for (size_t j=0;j<limbo.size();++j)
+			(*limbo[j].m_destroy)(limbo[j].m_ptr,limbo[j].m_param);
+	}
+
+	void release_record(void* p)
+	{
+		Record* r = static_cast<Record*>(p);
+
+		r->m_nesting = 0;
+		r->m_state.store(0,OOBase::memory_order_release);
+		r->reclaim(try_advance());
+
+		// Whatever is left is picked up by the next thread to claim the record, or to collect
+		r->m_in_use.store(0,OOBase::memory_order_release);
+	}
+
+	// Drain records left behind by threads that have exited
+	void reclaim_orphans(size_t epoch)
+	{
+		for (Record* r = OOBase::Atomic<Record*>::Load(s_records,OOBase::memory_order_acquire);r;r = r->m_next)
+		{
+			if (!r->m_in_use.load(OOBase::memory_order_relaxed) && r->m_in_use.CompareAndSwap(0,1) == 0)
+			{
+				r->reclaim(epoch);
+				r->m_in_use.store(0,OOBase::memory_order_release);
+			}
+		}
+	}
+
+	Record* claim()
+	{
+		for (Record* r = OOBase::Atomic<Record*>::Load(s_records,OOBase::memory_order_acquire);r;r = r->m_next)
+		{
+			if (!r->m_in_use.load(OOBase::memory_order_relaxed) && r->m_in_use.CompareAndSwap(0,1) == 0)
+				return r;
+		}
+		return NULL;
+	}
+
+	Record* record()
+	{
+		void* p = NULL;
+		if (OOBase::TLS::Get(&s_tls_key,&p))
+			return static_cast<Record*>(p);
+
+		Record* r = claim();
+		if (!r)
+		{
+			r = OOBase::CrtAllocator::allocate_new<Record>();
+			if (!r)
+				OOBase_CallCriticalFailure(ERROR_OUTOFMEMORY);
+
+			for (Record* head = OOBase::Atomic<Record*>::Load(s_records,OOBase::memory_order_relaxed);;)
+			{
+				r->m_next = head;
+
+				Record* prev = OOBase::Atomic<Record*>::CompareAndSwap(s_records,head,r);
+				if (prev == head)
+					break;
+				head = prev;
+			}
+		}
+
+		if (!OOBase::TLS::Set(&s_tls_key,r,&release_record))
+		{
+			release_record(r);
+			OOBase_CallCriticalFailure(OOBase::system_error());
+		}
+
+		return r;
+	}
+}
+
+void OOBase::Epoch::enter()
+{
+	Record* r = record();
+	if (r->m_nesting++ == 0)
+	{
+		// The exchange is a full barrier, so the state is published before any shared pointer is read
+		size_t epoch = Atomic<size_t>::Load(s_epoch,memory_order_relaxed);
+		r->m_state.Exchange((epoch << 1) | 1);
+	}
+}
+
+void OOBase::Epoch::exit()
+{
+	Record* r = record();
+	assert(r->m_nesting);
+
+	if (--r->m_nesting == 0)
+		r->m_state.store(0,memory_order_release);
+}
+
+void OOBase::Epoch::retire(void* ptr, void (*destroy)(void* ptr, void* param), void* param)
+{
+	if (!ptr)
+		return;
+
+	Record* r = record();
+
+	Retired ret;
+	ret.m_ptr = ptr;
+	ret.m_destroy = destroy;
+	ret.m_param = param;
+
+	// Read after ptr was unlinked, so no thread entering from now on can reach it
+	r->add(ret,Atomic<size_t>::Load(s_epoch));
+
+	if (r->m_pending >= s_collect_threshold)
+	{
+		size_t epoch = try_advance();
+		r->reclaim(epoch);
+		reclaim_orphans(epoch);
+	}
+}
+
+void OOBase::Epoch::collect()
+{
+	size_t epoch = try_advance();
+	record()->reclaim(epoch);
+	reclaim_orphans(epoch);
+}
@@ -19,24 +19,157 @@
 //
 ///////////////////////////////////////////////////////////////////////////////////
 
+#include "config-base.h"
+
 #include "../include/OOBase/Memory.h"
+#include "../include/OOBase/AllocatorStats.h"
 #include "../include/OOBase/Destructor.h"
 
 #if !defined(_WIN32)
 
-void* OOBase::CrtAllocator::allocate(size_t bytes, size_t /*align*/)
+#include <errno.h>
+#include <stdlib.h>
+
+#if defined(HAVE_MALLOC_H)
+#include <malloc.h>
+#endif
+
+namespace
+{
+	// malloc() already returns blocks aligned for any fundamental type
+	static const size_t s_malloc_align = 2*sizeof(void*);
+
+	void* aligned_malloc(size_t bytes, size_t align)
+	{
+#if defined(HAVE_POSIX_MEMALIGN)
+		void* p = NULL;
+		int err = ::posix_memalign(&p,align < sizeof(void*) ? sizeof(void*) : align,bytes);
+		if (err)
+		{
+			errno = err;
+			return NULL;
+		}
+		return p;
+#elif defined(HAVE_ALIGNED_ALLOC)
+		// aligned_alloc() insists on a whole multiple of the alignment
+		return ::aligned_alloc(align,(bytes + (align-1)) & ~(align-1));
+#else
+		return ::memalign(align,bytes);
+#endif
+	}
+
+#if defined(OOBASE_ALLOC_STATS) && defined(HAVE_MALLOC_USABLE_SIZE)
+#define OOBASE_CRT_STATS 1
+
+	// Without a way to size a block as it is freed, live bytes would be meaningless
+	static OOBase::detail::AllocatorCounters s_crt_stats;
+
+	void* count_allocation(void* p, size_t bytes)
+	{
+		if (p)
+			s_crt_stats.allocated(::malloc_usable_size(p));
+		else if (bytes)
+			s_crt_stats.failed();
+		return p;
+	}
+#endif
+
+	void* crt_allocate(size_t bytes, size_t align)
+	{
+		if (align <= s_malloc_align)
+			return ::malloc(bytes);
+
+		return aligned_malloc(bytes,align);
+	}
+
+	void* crt_reallocate(void* ptr, size_t bytes, size_t align)
+	{
+		if (align <= s_malloc_align)
+			return ::realloc(ptr,bytes);
+
+		if (!ptr)
+			return aligned_malloc(bytes,align);
+
+		if (!bytes)
+		{
+			::free(ptr);
+			return NULL;
+		}
+
+#if defined(HAVE_MALLOC_USABLE_SIZE)
+		size_t old_bytes = ::malloc_usable_size(ptr);
+		if (old_bytes >= bytes && !(reinterpret_cast<size_t>(ptr) & (align-1)))
+			return ptr;
+
+		void* new_ptr = aligned_malloc(bytes,align);
+		if (new_ptr)
+		{
+			memcpy(new_ptr,ptr,old_bytes < bytes ? old_bytes : bytes);
+			::free(ptr);
+		}
+		return new_ptr;
+#else
+		// We can't ask how big ptr is, so let realloc() do the copy and fix up the alignment after
+		void* new_ptr = aligned_malloc(bytes,align);
+		if (!new_ptr)
+			return NULL;
+
+		void* p = ::realloc(ptr,bytes);
+		if (!p || !(reinterpret_cast<size_t>(p) & (align-1)))
+		{
+			::free(new_ptr);
+			return p;
+		}
+
+		memcpy(new_ptr,p,bytes);
+		::free(p);
+		return new_ptr;
+#endif
+	}
+}
+
+void* OOBase::CrtAllocator::allocate(size_t bytes, size_t align)
 {
-	return ::malloc(bytes);
+#if defined(OOBASE_CRT_STATS)
+	return count_allocation(crt_allocate(bytes,align),bytes);
+#else
+	return crt_allocate(bytes,align);
+#endif
 }
 
-void* OOBase::CrtAllocator::reallocate(void* ptr, size_t bytes, size_t /*align*/)
+void* OOBase::CrtAllocator::reallocate(void* ptr, size_t bytes, size_t align)
 {
-	return ::realloc(ptr,bytes);
+#if defined(OOBASE_CRT_STATS)
+	size_t old_bytes = (ptr ? ::malloc_usable_size(ptr) : 0);
+
+	void* p = crt_reallocate(ptr,bytes,align);
+	if (ptr && (p || !bytes))
+		s_crt_stats.freed(old_bytes);
+
+	return count_allocation(p,bytes);
+#else
+	return crt_reallocate(ptr,bytes,align);
+#endif
 }
 
 void OOBase::CrtAllocator::free(void* ptr)
 {
+#if defined(OOBASE_CRT_STATS)
+	if (ptr)
+		s_crt_stats.freed(::malloc_usable_size(ptr));
+#endif
 	::free(ptr);
 }
 
+bool OOBase::CrtAllocator::get_stats(AllocatorStats& stats)
+{
+#if defined(OOBASE_CRT_STATS)
+	s_crt_stats.snapshot(stats);
+	return true;
+#else
+	(void)stats;
+	return false;
+#endif
+}
+
 #endif
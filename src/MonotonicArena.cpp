@@ -0,0 +1,239 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "../include/OOBase/MonotonicArena.h"
+
+namespace
+{
+	// Stop doubling the block size past 1MB
+	static const size_t s_max_block_size = 1024 * 1024;
+
+	char* align_up(char* p, size_t align)
+	{
+		if (align < 2)
+			return p;
+
+		return reinterpret_cast<char*>((reinterpret_cast<size_t>(p) + (align-1)) & ~(align-1));
+	}
+
+	// Every allocation is preceded by its size, which may not be aligned for a size_t
+	static const size_t s_header = sizeof(size_t);
+
+	size_t get_size(const char* p)
+	{
+		size_t len;
+		memcpy(&len,p - s_header,sizeof(len));
+		return len;
+	}
+
+	void set_size(char* p, size_t len)
+	{
+		memcpy(p - s_header,&len,sizeof(len));
+	}
+}
+
+OOBase::MonotonicArena::MonotonicArena(size_t block_size) :
+		m_buffer(NULL),
+		m_buffer_len(0),
+		m_block_size(block_size),
+		m_next_size(block_size),
+		m_blocks(NULL),
+		m_spare(NULL),
+		m_cur(NULL),
+		m_end(NULL),
+		m_last(NULL)
+{
+}
+
+OOBase::MonotonicArena::MonotonicArena(char* buffer, size_t len, size_t block_size) :
+		m_buffer(buffer),
+		m_buffer_len(len),
+		m_block_size(block_size),
+		m_next_size(block_size),
+		m_blocks(NULL),
+		m_spare(NULL),
+		m_cur(buffer),
+		m_end(buffer + len),
+		m_last(NULL)
+{
+}
+
+OOBase::MonotonicArena::~MonotonicArena()
+{
+	release();
+}
+
+void* OOBase::MonotonicArena::allocate(size_t bytes, size_t align)
+{
+	char* p = align_up(m_cur + s_header,align);
+	if (!m_cur || p + bytes > m_end)
+	{
+		if (!new_block(bytes,align))
+			return NULL;
+
+		p = align_up(m_cur + s_header,align);
+	}
+
+	set_size(p,bytes);
+	m_cur = p + bytes;
+	m_last = p;
+	return p;
+}
+
+void* OOBase::MonotonicArena::reallocate(void* ptr, size_t bytes, size_t align)
+{
+	if (!ptr)
+		return allocate(bytes,align);
+
+	if (!bytes)
+		return NULL;
+
+	char* p = static_cast<char*>(ptr);
+
+	size_t len = get_size(p);
+	if (!(reinterpret_cast<size_t>(p) & (align-1)))
+	{
+		// The most recent allocation can grow or shrink in place, any other can only shrink
+		if (p == m_last && p + bytes <= m_end)
+		{
+			set_size(p,bytes);
+			m_cur = p + bytes;
+			return ptr;
+		}
+
+		if (bytes <= len)
+		{
+			set_size(p,bytes);
+			return ptr;
+		}
+	}
+
+	void* new_ptr = allocate(bytes,align);
+	if (new_ptr)
+		memcpy(new_ptr,ptr,len < bytes ? len : bytes);
+
+	return new_ptr;
+}
+
+void OOBase::MonotonicArena::free(void*)
+{
+	// Memory is only reclaimed by reset() or release()
+}
+
+void OOBase::MonotonicArena::reset()
+{
+	// The newest block is the biggest, so keep it as the spare
+	if (m_blocks)
+	{
+		if (m_spare)
+			CrtAllocator::free(m_spare);
+
+		m_spare = m_blocks;
+		m_blocks = m_blocks->m_next;
+		m_spare->m_next = NULL;
+	}
+
+	free_blocks();
+	rewind();
+}
+
+void OOBase::MonotonicArena::release()
+{
+	if (m_spare)
+	{
+		CrtAllocator::free(m_spare);
+		m_spare = NULL;
+	}
+
+	free_blocks();
+	rewind();
+
+	m_next_size = m_block_size;
+}
+
+bool OOBase::MonotonicArena::new_block(size_t bytes, size_t align)
+{
+	size_t needed = sizeof(Block) + s_header + bytes + align;
+
+	Block* b = NULL;
+	if (m_spare && m_spare->m_size >= needed)
+	{
+		b = m_spare;
+		m_spare = NULL;
+	}
+	else
+	{
+		size_t size = m_next_size;
+		if (size < needed)
+			size = needed;
+
+		b = static_cast<Block*>(CrtAllocator::allocate(size,alignment_of<Block>::value));
+		if (!b)
+			return false;
+
+		b->m_size = size;
+
+		if (m_next_size < s_max_block_size)
+			m_next_size *= 2;
+	}
+
+	b->m_next = m_blocks;
+	m_blocks = b;
+
+	m_cur = reinterpret_cast<char*>(b + 1);
+	m_end = reinterpret_cast<char*>(b) + b->m_size;
+	return true;
+}
+
+void OOBase::MonotonicArena::free_blocks()
+{
+	while (m_blocks)
+	{
+		Block* next = m_blocks->m_next;
+		CrtAllocator::free(m_blocks);
+		m_blocks = next;
+	}
+}
+
+void OOBase::MonotonicArena::rewind()
+{
+	m_last = NULL;
+	if (m_buffer)
+	{
+		m_cur = m_buffer;
+		m_end = m_buffer + m_buffer_len;
+	}
+	else if (m_spare)
+	{
+		// Start straight back into the spare block
+		m_spare->m_next = NULL;
+		m_blocks = m_spare;
+		m_spare = NULL;
+
+		m_cur = reinterpret_cast<char*>(m_blocks + 1);
+		m_end = reinterpret_cast<char*>(m_blocks) + m_blocks->m_size;
+	}
+	else
+	{
+		m_cur = NULL;
+		m_end = NULL;
+	}
+}
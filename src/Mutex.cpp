@@ -19,9 +19,61 @@
 //
 ///////////////////////////////////////////////////////////////////////////////////
 
+#include "config-base.h"
+
 #include "../include/OOBase/Mutex.h"
+#include "../include/OOBase/Condition.h"
+#include "../include/OOBase/Once.h"
 #include "Win32Impl.h"
 
+#if defined(HAVE_LINUX_FUTEX_H)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <limits.h>
+#elif defined(_WIN32) && (_WIN32_WINNT >= 0x0602)
+#if defined(_MSC_VER)
+#pragma comment(lib, "synchronization.lib")
+#endif
+#endif
+
+namespace
+{
+	// Spin for at most 1+2+4+...+64 pauses before sleeping
+	static const unsigned int s_max_spin = 64;
+
+#if !defined(HAVE_LINUX_FUTEX_H) && !(defined(_WIN32) && (_WIN32_WINNT >= 0x0602))
+	// Without futexes, waiters park on one of a fixed set of condition variables, hashed by address
+	struct ParkingLot
+	{
+		OOBase::Condition::Mutex m_lock;
+		OOBase::Condition        m_cond;
+	};
+
+	static const size_t s_parking_lots = 32;
+	static ParkingLot* s_lots = NULL;
+
+	void init_lots()
+	{
+		ParkingLot* lots = static_cast<ParkingLot*>(OOBase::CrtAllocator::allocate(sizeof(ParkingLot) * s_parking_lots,OOBase::alignment_of<ParkingLot>::value));
+		if (!lots)
+			OOBase_CallCriticalFailure(ERROR_OUTOFMEMORY);
+
+		for (size_t i=0;i<s_parking_lots;++i)
+			::new (&lots[i]) ParkingLot();
+
+		s_lots = lots;
+	}
+
+	ParkingLot& parking_lot(const void* addr)
+	{
+		static OOBase::Once::once_t key = ONCE_T_INIT;
+		OOBase::Once::Run(&key,init_lots);
+
+		return s_lots[(reinterpret_cast<size_t>(addr) >> 2) % s_parking_lots];
+	}
+#endif
+}
+
 void OOBase::Mutex::swap(Mutex& rhs)
 {
 	OOBase::swap(m_mutex,rhs.m_mutex);
@@ -362,3 +414,227 @@ void OOBase::RWMutex::release_read()
 }
 
 #endif
+
+#if defined(HAVE_LINUX_FUTEX_H)
+
+bool OOBase::detail::futex_wait(uint32_t& val, uint32_t expected, const Timeout& timeout)
+{
+	::timespec wait = {0,0};
+	if (!timeout.is_infinite())
+	{
+		if (timeout.has_expired())
+			return false;
+
+		// The timeout may still expire before the remaining time is read
+		timeout.get_timespec(wait);
+		if (wait.tv_sec < 0 || (wait.tv_sec == 0 && wait.tv_nsec <= 0))
+			return false;
+	}
+
+	if (syscall(SYS_futex,&val,FUTEX_WAIT_PRIVATE,expected,timeout.is_infinite() ? NULL : &wait,NULL,0) == -1)
+	{
+		int err = errno;
+		if (err == ETIMEDOUT || (err == EINVAL && !timeout.is_infinite()))
+			return false;
+
+		// EAGAIN means val had already changed
+		if (err != EAGAIN && err != EINTR)
+			OOBase_CallCriticalFailure(err);
+	}
+	return true;
+}
+
+void OOBase::detail::futex_wake(uint32_t& val, bool all)
+{
+	syscall(SYS_futex,&val,FUTEX_WAKE_PRIVATE,all ? INT_MAX : 1,NULL,NULL,0);
+}
+
+#elif defined(_WIN32) && (_WIN32_WINNT >= 0x0602)
+
+bool OOBase::detail::futex_wait(uint32_t& val, uint32_t expected, const Timeout& timeout)
+{
+	if (!WaitOnAddress(&val,&expected,sizeof(val),timeout.millisecs()))
+	{
+		DWORD dwErr = GetLastError();
+		if (dwErr == ERROR_TIMEOUT)
+			return false;
+
+		OOBase_CallCriticalFailure(dwErr);
+	}
+	return true;
+}
+
+void OOBase::detail::futex_wake(uint32_t& val, bool all)
+{
+	if (all)
+		WakeByAddressAll(&val);
+	else
+		WakeByAddressSingle(&val);
+}
+
+#else
+
+bool OOBase::detail::futex_wait(uint32_t& val, uint32_t expected, const Timeout& timeout)
+{
+	ParkingLot& lot = parking_lot(&val);
+
+	Guard<Condition::Mutex> guard(lot.m_lock);
+
+	// futex_wake() takes the same lock, so val cannot change unseen between here and the wait
+	if (Atomic<uint32_t>::Load(val) != expected)
+		return true;
+
+	return lot.m_cond.wait(lot.m_lock,timeout);
+}
+
+void OOBase::detail::futex_wake(uint32_t& val, bool)
+{
+	ParkingLot& lot = parking_lot(&val);
+
+	// Other addresses share the lot, so everyone must be woken to check
+	Guard<Condition::Mutex> guard(lot.m_lock);
+	lot.m_cond.broadcast();
+}
+
+#endif
+
+bool OOBase::FastMutex::acquire_slow(const Timeout& timeout)
+{
+	// Spin with exponential backoff, but give up as soon as someone else is asleep
+	for (unsigned int spin = 1;spin <= s_max_spin;spin <<= 1)
+	{
+		for (unsigned int i=0;i<spin;++i)
+			detail::cpu_pause();
+
+		uint32_t state = Atomic<uint32_t>::Load(m_state,memory_order_relaxed);
+		if (state == 2)
+			break;
+
+		if (state == 0 && try_acquire())
+			return true;
+	}
+
+	// Mark the mutex as contended before sleeping, so release() knows to wake us
+	while (Atomic<uint32_t>::Exchange(m_state,2,memory_order_acquire) != 0)
+	{
+		if (!detail::futex_wait(m_state,2,timeout))
+			return false;
+	}
+	return true;
+}
+
+OOBase::BigReaderMutex::BigReaderMutex() :
+		m_writer(0),
+		m_drained(0)
+{
+	for (size_t i=0;i<s_slots;++i)
+		m_slots[i].m_readers = 0;
+}
+
+uint32_t& OOBase::BigReaderMutex::slot()
+{
+	// A thread must always return to the same slot, a per-CPU slot could change under us
+#if defined(_WIN32)
+	size_t id = GetCurrentThreadId() >> 2;
+#elif defined(HAVE_PTHREAD)
+	pthread_t self = pthread_self();
+	size_t id = 0;
+	memcpy(&id,&self,sizeof(self) < sizeof(id) ? sizeof(self) : sizeof(id));
+	id ^= (id >> 12) ^ (id >> 20);
+#endif
+	// Knuth's multiplicative hash: the top bits of the product are the well mixed ones
+	return m_slots[uint32_t(uint32_t(id) * 2654435761u) >> (32 - s_slot_bits)].m_readers;
+}
+
+bool OOBase::BigReaderMutex::readers_gone()
+{
+	for (size_t i=0;i<s_slots;++i)
+	{
+		if (Atomic<uint32_t>::Load(m_slots[i].m_readers))
+			return false;
+	}
+	return true;
+}
+
+void OOBase::BigReaderMutex::reader_leave(uint32_t& readers)
+{
+	Atomic<uint32_t>::Decrement(readers);
+
+	// Only a waiting writer cares
+	if (Atomic<uint32_t>::Load(m_writer))
+	{
+		Atomic<uint32_t>::Increment(m_drained);
+		detail::futex_wake(m_drained);
+	}
+}
+
+bool OOBase::BigReaderMutex::try_acquire_read()
+{
+	uint32_t& readers = slot();
+	Atomic<uint32_t>::Increment(readers);
+
+	// The increment and this load are both sequentially consistent, so either we see the writer or it sees us
+	if (!Atomic<uint32_t>::Load(m_writer))
+		return true;
+
+	reader_leave(readers);
+	return false;
+}
+
+void OOBase::BigReaderMutex::acquire_read()
+{
+	while (!try_acquire_read())
+	{
+		// Let the writer know we are asleep, and wait for it to finish
+		for (uint32_t w = Atomic<uint32_t>::Load(m_writer);w;w = Atomic<uint32_t>::Load(m_writer))
+		{
+			if (w == 2 || Atomic<uint32_t>::CompareAndSwap(m_writer,1,2) == 1)
+				detail::futex_wait(m_writer,2);
+		}
+	}
+}
+
+void OOBase::BigReaderMutex::release_read()
+{
+	reader_leave(slot());
+}
+
+bool OOBase::BigReaderMutex::try_acquire()
+{
+	if (!m_writer_lock.try_acquire())
+		return false;
+
+	Atomic<uint32_t>::Exchange(m_writer,1);
+	if (readers_gone())
+		return true;
+
+	release();
+	return false;
+}
+
+void OOBase::BigReaderMutex::acquire()
+{
+	m_writer_lock.acquire();
+
+	Atomic<uint32_t>::Exchange(m_writer,1);
+	for (;;)
+	{
+		uint32_t drained = Atomic<uint32_t>::Load(m_drained);
+		if (readers_gone())
+			break;
+
+		for (unsigned int i=0;i<s_max_spin;++i)
+			detail::cpu_pause();
+
+		if (!readers_gone())
+			detail::futex_wait(m_drained,drained);
+	}
+}
+
+void OOBase::BigReaderMutex::release()
+{
+	if (Atomic<uint32_t>::Exchange(m_writer,0) == 2)
+		detail::futex_wake(m_writer,true);
+
+	m_writer_lock.release();
+}
@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "../include/OOBase/PoolAllocator.h"
+#include "../include/OOBase/TLSSingleton.h"
+
+namespace
+{
+	// Aim for slabs of around 16K, but never fewer than 8 blocks
+	static const size_t s_slab_bytes = 16 * 1024;
+	static const size_t s_min_per_slab = 8;
+
+	// A full magazine is flushed down to half, and an empty one refilled up to half
+	static const size_t s_magazine_size = 32;
+
+	char* align_up(char* p, size_t align)
+	{
+		return reinterpret_cast<char*>((reinterpret_cast<size_t>(p) + (align-1)) & ~(align-1));
+	}
+}
+
+struct OOBase::detail::FixedPool::Magazine
+{
+	FixedPool* m_pool;
+	Magazine*  m_next;
+	Magazine*  m_prev;
+	size_t     m_count;
+	void*      m_blocks[s_magazine_size];
+};
+
+OOBase::detail::FixedPool::FixedPool(size_t size, size_t align, bool magazines) :
+		m_size(size),
+		m_align(align),
+		m_per_slab(0),
+		m_magazines(magazines),
+		m_free(),
+		m_slabs(NULL),
+		m_mags(NULL)
+{
+	if (m_align < alignment_of<void*>::value)
+		m_align = alignment_of<void*>::value;
+
+	// Every block must be able to hold the free list link, and keep its neighbour aligned
+	if (m_size < sizeof(void*))
+		m_size = sizeof(void*);
+	m_size = (m_size + (m_align-1)) & ~(m_align-1);
+
+	m_per_slab = s_slab_bytes / m_size;
+	if (m_per_slab < s_min_per_slab)
+		m_per_slab = s_min_per_slab;
+}
+
+OOBase::detail::FixedPool::~FixedPool()
+{
+	Guard<SpinLock> guard(m_lock);
+
+	// Disown any magazines still attached to living threads
+	for (Magazine* mag = m_mags;mag;mag = mag->m_next)
+	{
+		mag->m_pool = NULL;
+		mag->m_count = 0;
+	}
+
+	while (m_slabs)
+	{
+		void* next = *static_cast<void**>(m_slabs);
+		CrtAllocator::free(m_slabs);
+		m_slabs = next;
+	}
+}
+
+void* OOBase::detail::FixedPool::allocate()
+{
+	if (m_magazines)
+	{
+		Magazine* mag = magazine();
+		if (mag)
+		{
+			if (!mag->m_count)
+			{
+				while (mag->m_count < s_magazine_size/2)
+				{
+					void* p = central_allocate();
+					if (!p)
+						break;
+
+					mag->m_blocks[mag->m_count++] = p;
+				}
+			}
+
+			return (mag->m_count ? mag->m_blocks[--mag->m_count] : NULL);
+		}
+	}
+
+	return central_allocate();
+}
+
+void OOBase::detail::FixedPool::free(void* ptr)
+{
+	if (!ptr)
+		return;
+
+	if (m_magazines)
+	{
+		Magazine* mag = magazine();
+		if (mag)
+		{
+			if (mag->m_count == s_magazine_size)
+			{
+				while (mag->m_count > s_magazine_size/2)
+					central_free(mag->m_blocks[--mag->m_count]);
+			}
+
+			mag->m_blocks[mag->m_count++] = ptr;
+			return;
+		}
+	}
+
+	central_free(ptr);
+}
+
+void* OOBase::detail::FixedPool::central_allocate()
+{
+	void* p = m_free.pop();
+	if (!p)
+	{
+		// Only one thread grows the pool, the others find its blocks when they get the lock
+		Guard<SpinLock> guard(m_lock);
+
+		p = m_free.pop();
+		if (!p && grow())
+			p = m_free.pop();
+	}
+	return p;
+}
+
+void OOBase::detail::FixedPool::central_free(void* ptr)
+{
+	m_free.push(ptr);
+}
+
+bool OOBase::detail::FixedPool::grow()
+{
+	// Each slab starts with the link to the next, followed by the aligned blocks
+	char* slab = static_cast<char*>(CrtAllocator::allocate(sizeof(void*) + m_align + m_per_slab * m_size,m_align));
+	if (!slab)
+		return false;
+
+	*reinterpret_cast<void**>(slab) = m_slabs;
+	m_slabs = slab;
+
+	char* block = align_up(slab + sizeof(void*),m_align);
+	for (size_t i=0;i<m_per_slab;++i,block += m_size)
+		central_free(block);
+
+	return true;
+}
+
+OOBase::detail::FixedPool::Magazine* OOBase::detail::FixedPool::magazine()
+{
+	void* p = NULL;
+	if (TLS::Get(this,&p))
+	{
+		Magazine* mag = static_cast<Magazine*>(p);
+
+		// A magazine left behind by a destroyed pool at the same address
+		if (mag->m_pool != this)
+			attach(mag);
+
+		return mag;
+	}
+
+	Magazine* mag = CrtAllocator::allocate_new<Magazine>();
+	if (!mag)
+		return NULL;
+
+	if (!TLS::Set(this,mag,&destroy_magazine))
+	{
+		CrtAllocator::delete_free(mag);
+		return NULL;
+	}
+
+	attach(mag);
+	return mag;
+}
+
+void OOBase::detail::FixedPool::attach(Magazine* mag)
+{
+	Guard<SpinLock> guard(m_lock);
+
+	mag->m_pool = this;
+	mag->m_count = 0;
+	mag->m_prev = NULL;
+	mag->m_next = m_mags;
+	if (m_mags)
+		m_mags->m_prev = mag;
+	m_mags = mag;
+}
+
+void OOBase::detail::FixedPool::detach(Magazine* mag)
+{
+	while (mag->m_count)
+		central_free(mag->m_blocks[--mag->m_count]);
+
+	Guard<SpinLock> guard(m_lock);
+
+	if (mag->m_prev)
+		mag->m_prev->m_next = mag->m_next;
+	else
+		m_mags = mag->m_next;
+
+	if (mag->m_next)
+		mag->m_next->m_prev = mag->m_prev;
+
+	mag->m_pool = NULL;
+}
+
+void OOBase::detail::FixedPool::destroy_magazine(void* p)
+{
+	Magazine* mag = static_cast<Magazine*>(p);
+	if (mag->m_pool)
+		mag->m_pool->detach(mag);
+
+	CrtAllocator::delete_free(mag);
+}
+
+OOBase::PoolAllocatorInstance::PoolAllocatorInstance(size_t size, size_t align, bool magazines) :
+		m_align(align),
+		m_pool(size,align,magazines)
+{
+}
+
+void* OOBase::PoolAllocatorInstance::allocate(size_t bytes, size_t align)
+{
+	if (bytes > m_pool.block_size() || align > m_align)
+		return NULL;
+
+	return m_pool.allocate();
+}
+
+void* OOBase::PoolAllocatorInstance::reallocate(void* ptr, size_t bytes, size_t align)
+{
+	if (!ptr)
+		return allocate(bytes,align);
+
+	if (!bytes)
+	{
+		m_pool.free(ptr);
+		return NULL;
+	}
+
+	return (bytes <= m_pool.block_size() && align <= m_align) ? ptr : NULL;
+}
+
+void OOBase::PoolAllocatorInstance::free(void* ptr)
+{
+	m_pool.free(ptr);
+}
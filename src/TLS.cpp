@@ -23,6 +23,8 @@
 #include "../include/OOBase/Singleton.h"
 #include "../include/OOBase/HashTable.h"
 #include "../include/OOBase/ArenaAllocator.h"
+#include "../include/OOBase/Atomic.h"
+#include "../include/OOBase/AllocatorStats.h"
 
 namespace OOBase
 {
@@ -37,19 +39,16 @@ namespace
 	class TLSGlobal : public OOBase::NonCopyable
 	{
 	public:
-		TLSGlobal() : m_mapVals(m_allocator), m_listDestructors(m_allocator), m_refcount(1)
-		{}
-
+		TLSGlobal();
 		~TLSGlobal();
 
-		void addref() 
-		{
-			++m_refcount; 
-		}
-
-		void release();
+		void exit_thread();
 
 		static TLSGlobal* instance(bool create);
+
+		void* allocate(size_t bytes, size_t align);
+		void* reallocate(void* ptr, size_t bytes, size_t align);
+		static void free(void* ptr);
 		
 		OOBase::ArenaAllocator m_allocator;
 
@@ -64,9 +63,83 @@ namespace
 		// Special internal thread-local variables
 		char m_error_buffer[512];
 
+#if defined(OOBASE_ALLOC_STATS)
+		// Blocks allocated by this thread, wherever they are freed
+		OOBase::detail::AllocatorCounters m_stats;
+#endif
+
 	private:
-		size_t m_refcount;
+		// Live blocks are counted without atomics: m_live by the owning thread, and frees from
+		// other threads count m_shared down.  The owner folds m_live into m_shared as it exits,
+		// adding s_exited, and whichever free then brings m_shared to exactly s_exited deletes the heap.
+		static const size_t s_exited = (size_t(1) << (sizeof(size_t)*8 - 1));
+
+		size_t m_live;
+		size_t m_shared;
+
+		// Thread cache of freed small blocks, one free list per size class (16 << class bytes)
+		static const size_t s_classes = 8;
+		static const size_t s_cache_depth = 32;
+
+		void*  m_cache[s_classes];
+		size_t m_cache_count[s_classes];
+
+		// Blocks freed by other threads, pushed lock-free and reclaimed by the owner
+		OOBase::Atomic<void*> m_remote;
+		OOBase::Atomic<int>   m_orphaned;
+
+#if defined(_WIN32)
+		DWORD     m_thread;
+#elif defined(HAVE_PTHREAD)
+		pthread_t m_thread;
+#endif
+
+		bool is_owner() const;
+		void detach();
+		void local_free(void* ptr);
+		void drain();
+
+		void count_allocation(size_t bytes);
+		void count_failure();
+		static size_t block_size(void* ptr);
 	};
+
+	// Every block handed out is preceded by a header, padded to keep small blocks 16-byte aligned.
+	// Large blocks also record their requested size immediately before the header.
+	struct BlockHeader
+	{
+		TLSGlobal*       m_owner;
+		OOBase::uint32_t m_class;
+		OOBase::uint32_t m_offset;
+	};
+
+	static const size_t s_header_size = 16;
+
+	BlockHeader* header(void* ptr)
+	{
+		return reinterpret_cast<BlockHeader*>(static_cast<char*>(ptr) - s_header_size);
+	}
+
+	size_t* large_size(void* ptr)
+	{
+		return reinterpret_cast<size_t*>(static_cast<char*>(ptr) - s_header_size) - 1;
+	}
+
+#if defined(OOBASE_ALLOC_STATS)
+	// Every thread's heap together
+	static OOBase::detail::AllocatorCounters s_heap_stats;
+#endif
+
+#if defined(__GNUC__)
+#define OOBASE_THREAD_LOCAL __thread
+#elif defined(_MSC_VER) && (_MSC_VER >= 1900)
+#define OOBASE_THREAD_LOCAL __declspec(thread)
+#endif
+
+#if defined(OOBASE_THREAD_LOCAL)
+	// A copy of the TLS slot, so the allocator's fast path is a single load
+	static OOBASE_THREAD_LOCAL TLSGlobal* s_current = NULL;
+#endif
 }
 
 #if defined(_WIN32)
@@ -84,7 +157,7 @@ namespace
 
 	void term(void* inst)
 	{
-		static_cast<TLSGlobal*>(inst)->release();
+		static_cast<TLSGlobal*>(inst)->exit_thread();
 	}
 }
 
@@ -96,7 +169,7 @@ void WINAPI on_tls_callback(HANDLE, DWORD dwReason, PVOID)
 		if (inst)
 		{
 			OOBase::DLLDestructor<OOBase::Module>::remove_destructor(&term,inst);
-			inst->release();
+			inst->exit_thread();
 		}
 	}
 }
@@ -131,6 +204,11 @@ PIMAGE_TLS_CALLBACK _xl_b = &on_tls_callback;
 
 TLSGlobal* TLSGlobal::instance(bool create)
 {
+#if defined(OOBASE_THREAD_LOCAL)
+	if (s_current)
+		return s_current;
+#endif
+
 	static OOBase::Once::once_t key = ONCE_T_INIT;
 	OOBase::Once::Run(&key,init);
 		
@@ -148,16 +226,22 @@ TLSGlobal* TLSGlobal::instance(bool create)
 			}
 		}
 	}
+
+#if defined(OOBASE_THREAD_LOCAL)
+	s_current = inst;
+#endif
 	return inst;
 }
 
-void TLSGlobal::release()
+void TLSGlobal::detach()
 {
-	if (--m_refcount == 0)
-	{
-		OOBase::CrtAllocator::delete_free(this);
+	if (s_key != TLS_OUT_OF_INDEXES && TlsGetValue(s_key) == this)
 		TlsSetValue(s_key,NULL);
-	}
+}
+
+bool TLSGlobal::is_owner() const
+{
+	return (!m_orphaned && m_thread == GetCurrentThreadId());
 }
 
 #elif defined(HAVE_PTHREAD)
@@ -168,8 +252,7 @@ namespace
 
 	void term(void* inst)
 	{
-		static_cast<TLSGlobal*>(inst)->release();
-		pthread_setspecific(s_key,NULL);
+		static_cast<TLSGlobal*>(inst)->exit_thread();
 	}
 
 	void thread_destruct(void* inst)
@@ -177,7 +260,7 @@ namespace
 		if (inst)
 		{
 			OOBase::DLLDestructor<OOBase::Module>::remove_destructor(&term,inst);
-			static_cast<TLSGlobal*>(inst)->release();
+			static_cast<TLSGlobal*>(inst)->exit_thread();
 		}
 	}
 
@@ -189,6 +272,11 @@ namespace
 
 TLSGlobal* TLSGlobal::instance(bool create)
 {
+#if defined(OOBASE_THREAD_LOCAL)
+	if (s_current)
+		return s_current;
+#endif
+
 	static OOBase::Once::once_t key = ONCE_T_INIT;
 	OOBase::Once::Run(&key,init);
 		
@@ -203,17 +291,50 @@ TLSGlobal* TLSGlobal::instance(bool create)
 		}
 	}
 		
+#if defined(OOBASE_THREAD_LOCAL)
+	s_current = inst;
+#endif
 	return inst;
 }
 
-void TLSGlobal::release()
+void TLSGlobal::detach()
 {
-	if (--m_refcount == 0)
-		OOBase::CrtAllocator::delete_free(this);
+	if (pthread_getspecific(s_key) == this)
+		pthread_setspecific(s_key,NULL);
 }
 
+bool TLSGlobal::is_owner() const
+{
+	return (!m_orphaned && pthread_equal(m_thread,pthread_self()));
+}
+
+#endif
+
+TLSGlobal::TLSGlobal() : 
+		m_mapVals(m_allocator), 
+		m_listDestructors(m_allocator), 
+		m_live(0),
+		m_shared(0),
+		m_remote(NULL),
+		m_orphaned(0)
+{
+	for (size_t i=0;i<s_classes;++i)
+	{
+		m_cache[i] = NULL;
+		m_cache_count[i] = 0;
+	}
+
+#if defined(OOBASE_ALLOC_STATS)
+	memset(&m_stats,0,sizeof(m_stats));
 #endif
 
+#if defined(_WIN32)
+	m_thread = GetCurrentThreadId();
+#elif defined(HAVE_PTHREAD)
+	m_thread = pthread_self();
+#endif
+}
+
 TLSGlobal::~TLSGlobal()
 {
 	for (tls_val val;m_listDestructors.pop_back(&val);)
@@ -222,6 +343,227 @@ TLSGlobal::~TLSGlobal()
 		if (i)
 			(*val.m_destructor)(i->second);
 	}
+
+	// Any cached or remotely freed blocks go with m_allocator's mspace
+}
+
+void TLSGlobal::exit_thread()
+{
+	// Called as the owning thread exits, or the module unloads: from now on every free() is remote
+	if (m_orphaned.Exchange(1))
+		return;
+
+	detach();
+
+#if defined(OOBASE_THREAD_LOCAL)
+	if (s_current == this)
+		s_current = NULL;
+#endif
+
+	drain();
+
+	if (OOBase::Atomic<size_t>::Add(m_shared,m_live + s_exited) == s_exited)
+		OOBase::CrtAllocator::delete_free(this);
+}
+
+void* TLSGlobal::allocate(size_t bytes, size_t align)
+{
+	if (align <= s_header_size && bytes <= (size_t(16) << (s_classes-1)))
+	{
+		size_t c = 0;
+		while ((size_t(16) << c) < bytes)
+			++c;
+
+		void* p = m_cache[c];
+		if (!p && m_remote != NULL)
+		{
+			drain();
+			p = m_cache[c];
+		}
+
+		if (p)
+		{
+			m_cache[c] = *static_cast<void**>(p);
+			--m_cache_count[c];
+		}
+		else
+		{
+			char* base = static_cast<char*>(m_allocator.allocate(s_header_size + (size_t(16) << c),s_header_size));
+			if (!base)
+			{
+				count_failure();
+				return NULL;
+			}
+
+			p = base + s_header_size;
+			BlockHeader* h = header(p);
+			h->m_owner = this;
+			h->m_class = static_cast<OOBase::uint32_t>(c);
+			h->m_offset = static_cast<OOBase::uint32_t>(s_header_size);
+		}
+
+		count_allocation(size_t(16) << c);
+		++m_live;
+		return p;
+	}
+
+	// Large or over-aligned blocks come straight from the arena
+	if (m_remote != NULL)
+		drain();
+
+	size_t offset = (align > 2*s_header_size ? align : 2*s_header_size);
+	char* base = static_cast<char*>(m_allocator.allocate(offset + bytes,align > s_header_size ? align : s_header_size));
+	if (!base)
+	{
+		count_failure();
+		return NULL;
+	}
+
+	void* p = base + offset;
+	BlockHeader* h = header(p);
+	h->m_owner = this;
+	h->m_class = static_cast<OOBase::uint32_t>(s_classes);
+	h->m_offset = static_cast<OOBase::uint32_t>(offset);
+	*large_size(p) = bytes;
+
+	count_allocation(bytes);
+	++m_live;
+	return p;
+}
+
+void* TLSGlobal::reallocate(void* ptr, size_t bytes, size_t align)
+{
+	if (!ptr)
+		return allocate(bytes,align);
+
+	if (!bytes)
+	{
+		free(ptr);
+		return NULL;
+	}
+
+	size_t size = block_size(ptr);
+
+	// Shrinking, or growing within the size class, is free as long as the alignment still holds
+	if (bytes <= size && !(reinterpret_cast<size_t>(ptr) & (align-1)))
+		return ptr;
+
+	// Our own large blocks can be resized by the mspace, in place if there is room after them
+	BlockHeader* h = header(ptr);
+	if (h->m_class == s_classes && h->m_owner == this && is_owner() && align <= h->m_offset)
+	{
+		size_t offset = h->m_offset;
+		char* base = static_cast<char*>(m_allocator.reallocate(static_cast<char*>(ptr) - offset,offset + bytes,align > s_header_size ? align : s_header_size));
+		if (!base)
+		{
+			count_failure();
+			return NULL;
+		}
+
+		// The header came along with the rest of the block
+		void* p = base + offset;
+		*large_size(p) = bytes;
+
+#if defined(OOBASE_ALLOC_STATS)
+		m_stats.freed(size);
+		s_heap_stats.freed(size);
+#endif
+		count_allocation(bytes);
+		return p;
+	}
+
+	// Otherwise move it into this thread's heap, which may not be the block's owner
+	void* p = allocate(bytes,align);
+	if (p)
+	{
+		memcpy(p,ptr,size < bytes ? size : bytes);
+		free(ptr);
+	}
+	return p;
+}
+
+void TLSGlobal::free(void* ptr)
+{
+	if (!ptr)
+		return;
+
+	TLSGlobal* owner = header(ptr)->m_owner;
+
+#if defined(OOBASE_ALLOC_STATS)
+	size_t size = block_size(ptr);
+	owner->m_stats.freed(size);
+	s_heap_stats.freed(size);
+#endif
+
+	if (owner->is_owner())
+	{
+		owner->local_free(ptr);
+		--owner->m_live;
+	}
+	else
+	{
+		// Push the block onto the owner's remote list, it will be reclaimed on the owner's next allocation
+		for (void* head = owner->m_remote;;)
+		{
+			*static_cast<void**>(ptr) = head;
+
+			void* prev = owner->m_remote.CompareAndSwap(head,ptr);
+			if (prev == head)
+				break;
+
+			head = prev;
+		}
+
+		if (OOBase::Atomic<size_t>::Decrement(owner->m_shared) == s_exited)
+			OOBase::CrtAllocator::delete_free(owner);
+	}
+}
+
+void TLSGlobal::local_free(void* ptr)
+{
+	BlockHeader* h = header(ptr);
+	if (h->m_class < s_classes && m_cache_count[h->m_class] < s_cache_depth)
+	{
+		*static_cast<void**>(ptr) = m_cache[h->m_class];
+		m_cache[h->m_class] = ptr;
+		++m_cache_count[h->m_class];
+	}
+	else
+		m_allocator.free(static_cast<char*>(ptr) - h->m_offset);
+}
+
+size_t TLSGlobal::block_size(void* ptr)
+{
+	BlockHeader* h = header(ptr);
+	return (h->m_class < s_classes ? (size_t(16) << h->m_class) : *large_size(ptr));
+}
+
+void TLSGlobal::count_allocation(size_t bytes)
+{
+#if defined(OOBASE_ALLOC_STATS)
+	m_stats.allocated(bytes);
+	s_heap_stats.allocated(bytes);
+#else
+	(void)bytes;
+#endif
+}
+
+void TLSGlobal::count_failure()
+{
+#if defined(OOBASE_ALLOC_STATS)
+	m_stats.failed();
+	s_heap_stats.failed();
+#endif
+}
+
+void TLSGlobal::drain()
+{
+	for (void* p = m_remote.Exchange(NULL);p;)
+	{
+		void* next = *static_cast<void**>(p);
+		local_free(p);
+		p = next;
+	}
 }
 
 bool OOBase::TLS::Get(const void* key, void** val)
@@ -294,10 +636,7 @@ void* OOBase::ThreadLocalAllocator::allocate(size_t bytes, size_t align)
 	if (!inst)
 		return NULL;
 
-	void* p = inst->m_allocator.allocate(bytes,align);
-	if (p)
-		inst->addref();
-	return p;
+	return inst->allocate(bytes,align);
 }
 
 void* OOBase::ThreadLocalAllocator::reallocate(void* ptr, size_t bytes, size_t align)
@@ -306,21 +645,37 @@ void* OOBase::ThreadLocalAllocator::reallocate(void* ptr, size_t bytes, size_t a
 	if (!inst)
 		return NULL;
 
-	void* p = inst->m_allocator.reallocate(ptr,bytes,align);
-	if (ptr && !bytes)
-		inst->release();
-	else if (p && !ptr)
-		inst->addref();
-	return p;
+	return inst->reallocate(ptr,bytes,align);
 }
 
 void OOBase::ThreadLocalAllocator::free(void* ptr)
 {
+	// The block header knows which thread's heap it belongs to
+	TLSGlobal::free(ptr);
+}
+
+bool OOBase::ThreadLocalAllocator::get_stats(AllocatorStats& stats)
+{
+#if defined(OOBASE_ALLOC_STATS)
+	s_heap_stats.snapshot(stats);
+	return true;
+#else
+	(void)stats;
+	return false;
+#endif
+}
+
+bool OOBase::ThreadLocalAllocator::get_thread_stats(AllocatorStats& stats)
+{
+#if defined(OOBASE_ALLOC_STATS)
 	TLSGlobal* inst = TLSGlobal::instance(false);
 	if (inst)
-	{
-		inst->m_allocator.free(ptr);
-		if (ptr)
-			inst->release();
-	}
+		inst->m_stats.snapshot(stats);
+	else
+		memset(&stats,0,sizeof(stats));
+	return true;
+#else
+	(void)stats;
+	return false;
+#endif
 }
@@ -0,0 +1,266 @@
+///////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2015 Rick Taylor
+//
+// This file is part of OOBase, the Omega Online Base library.
+//
+// OOBase is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OOBase is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with OOBase.  If not, see <http://www.gnu.org/licenses/>.
+//
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "../include/OOBase/TLSSingleton.h"
+#include "../include/OOBase/TaskScheduler.h"
+
+OOBase::TaskScheduler::TaskScheduler() :
+		m_next_worker(0),
+		m_next_submit(0),
+		m_pending(0),
+		m_active(0),
+		m_sleepers(0),
+		m_submitters(0),
+		m_state(eClosed)
+{
+}
+
+OOBase::TaskScheduler::~TaskScheduler()
+{
+	abort();
+}
+
+int OOBase::TaskScheduler::run(size_t threads)
+{
+	if (!threads || !m_workers.empty())
+	{
+#if defined(_WIN32)
+		return ERROR_INVALID_PARAMETER;
+#else
+		return EINVAL;
+#endif
+	}
+
+	for (size_t i=0;i<threads;++i)
+	{
+		Worker* worker = CrtAllocator::allocate_new<Worker>();
+		if (!worker)
+		{
+			int err = system_error();
+			stop(true);
+			return err;
+		}
+
+		if (!m_workers.push_back(worker))
+		{
+			int err = system_error();
+			CrtAllocator::delete_free(worker);
+			stop(true);
+			return err;
+		}
+	}
+
+	m_state = eRunning;
+
+	int err = m_pool.run(&worker_fn,this,threads);
+	if (err)
+		stop(true);
+
+	return err;
+}
+
+bool OOBase::TaskScheduler::submit(const task_t& task)
+{
+	if (!task)
+		return false;
+
+	// Tasks submitted from one of our own workers go onto its own deque,
+	// and are still accepted while join() is draining
+	void* p = NULL;
+	if (TLS::Get(this,&p))
+	{
+		if (m_state == eAborted)
+			return false;
+
+		return push(static_cast<Worker*>(p),task);
+	}
+
+	// Announce ourselves before looking at the state, stop() waits for us before freeing the workers
+	++m_submitters;
+
+	bool ret = false;
+	if (m_state == eRunning)
+		ret = push(m_workers[m_next_submit++ % m_workers.size()],task);
+
+	--m_submitters;
+	return ret;
+}
+
+bool OOBase::TaskScheduler::push(Worker* worker, const task_t& task)
+{
+	// Counted before it is visible, so a thief can never take m_pending below 0
+	++m_pending;
+
+	Guard<SpinLock> guard(worker->m_lock);
+
+	if (!worker->m_tasks.push(task))
+	{
+		guard.release();
+		--m_pending;
+		return false;
+	}
+
+	guard.release();
+
+	if (m_sleepers != 0)
+		wake(false);
+
+	return true;
+}
+
+void OOBase::TaskScheduler::join()
+{
+	stop(false);
+}
+
+void OOBase::TaskScheduler::abort()
+{
+	stop(true);
+}
+
+size_t OOBase::TaskScheduler::threads() const
+{
+	return m_workers.size();
+}
+
+size_t OOBase::TaskScheduler::pending() const
+{
+	return m_pending;
+}
+
+int OOBase::TaskScheduler::worker_fn(void* param)
+{
+	TaskScheduler* pThis = static_cast<TaskScheduler*>(param);
+
+	size_t idx = pThis->m_next_worker++;
+	if (!TLS::Set(pThis,pThis->m_workers[idx]))
+		OOBase_CallCriticalFailure(system_error());
+
+	return pThis->worker_run(idx);
+}
+
+int OOBase::TaskScheduler::worker_run(size_t idx)
+{
+	while (m_state != eAborted)
+	{
+		task_t task;
+		if (pop(idx,task))
+		{
+			++m_active;
+			--m_pending;
+
+			task.invoke();
+
+			// The last running task during a join() may be the one that lets everyone go
+			if (--m_active == 0 && m_pending == 0 && m_state == eStopping)
+				wake(true);
+		}
+		else if (!park())
+			break;
+	}
+
+	return 0;
+}
+
+bool OOBase::TaskScheduler::pop(size_t idx, task_t& task)
+{
+	// Our own deque first, newest first while it is still hot in cache
+	Worker* worker = m_workers[idx];
+	Guard<SpinLock> guard(worker->m_lock);
+
+	if (worker->m_tasks.pop_back(&task))
+		return true;
+
+	guard.release();
+
+	// Then steal the oldest task from each of our siblings in turn
+	size_t count = m_workers.size();
+	for (size_t i=1;i<count;++i)
+	{
+		Worker* victim = m_workers[(idx + i) % count];
+
+		// Don't queue up behind a sibling that is busy with its own deque
+		Guard<SpinLock> guard2(victim->m_lock,false);
+		if (!guard2.try_acquire())
+			continue;
+
+		if (victim->m_tasks.pop(&task))
+			return true;
+	}
+
+	return false;
+}
+
+bool OOBase::TaskScheduler::park()
+{
+	Guard<Condition::Mutex> guard(m_park_lock);
+
+	++m_sleepers;
+
+	while (m_pending == 0 && (m_state == eRunning || (m_state == eStopping && m_active != 0)))
+		m_park.wait(m_park_lock);
+
+	--m_sleepers;
+
+	// join() drains the queues before letting the workers go, abort() does not
+	return (m_state == eRunning || (m_state == eStopping && m_pending != 0));
+}
+
+void OOBase::TaskScheduler::wake(bool all)
+{
+	Guard<Condition::Mutex> guard(m_park_lock);
+
+	if (all)
+		m_park.broadcast();
+	else
+		m_park.signal();
+}
+
+void OOBase::TaskScheduler::stop(bool abort)
+{
+	Guard<Condition::Mutex> guard(m_park_lock);
+
+	m_state = (abort ? eAborted : eStopping);
+
+	guard.release();
+
+	// Any submit() that saw eRunning is still using m_workers
+	while (m_submitters != 0)
+		Thread::yield();
+
+	wake(true);
+
+	m_pool.join();
+
+	// Anything left behind is discarded
+	for (size_t i=0;i<m_workers.size();++i)
+		CrtAllocator::delete_free(m_workers[i]);
+
+	while (m_workers.pop_back())
+		;
+
+	m_next_worker = 0;
+	m_next_submit = 0;
+	m_pending = 0;
+	m_active = 0;
+	m_sleepers = 0;
+	m_state = eClosed;
+}
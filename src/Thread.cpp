@@ -374,7 +374,7 @@ void OOBase::ThreadPool::join()
 {
 	Guard<Mutex> guard(m_lock);
 
-	for (SharedPtr<Thread> ptrThread;!m_threads.pop_back(&ptrThread);)
+	for (SharedPtr<Thread> ptrThread;m_threads.pop_back(&ptrThread);)
 	{
 		guard.release();
 
@@ -388,7 +388,7 @@ void OOBase::ThreadPool::abort()
 {
 	Guard<Mutex> guard(m_lock);
 
-	for (SharedPtr<Thread> ptrThread;!m_threads.pop_back(&ptrThread);)
+	for (SharedPtr<Thread> ptrThread;m_threads.pop_back(&ptrThread);)
 	{
 		guard.release();
 
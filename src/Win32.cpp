@@ -1010,30 +1010,97 @@ void OOBase::CrtAllocator::free(void* ptr)
 
 #else
 
-void* OOBase::CrtAllocator::allocate(size_t len, size_t /*align*/)
+#if !defined(MEMORY_ALLOCATION_ALIGNMENT)
+#define MEMORY_ALLOCATION_ALIGNMENT (2*sizeof(void*))
+#endif
+
+namespace
+{
+	// HeapAlloc() only guarantees MEMORY_ALLOCATION_ALIGNMENT, so every block is over-allocated
+	// by at least that much, with the real heap block stored just before the returned pointer.
+	// Aligned and unaligned requests then share one layout, and free() never has to guess
+	size_t heap_align(size_t align)
+	{
+		return (align < MEMORY_ALLOCATION_ALIGNMENT ? MEMORY_ALLOCATION_ALIGNMENT : align);
+	}
+
+	char*& heap_block(void* ptr)
+	{
+		return static_cast<char**>(ptr)[-1];
+	}
+
+	void* heap_place(char* block, size_t align)
+	{
+		char* p = reinterpret_cast<char*>((reinterpret_cast<size_t>(block) + sizeof(char*) + (align-1)) & ~(align-1));
+		heap_block(p) = block;
+		return p;
+	}
+}
+
+void* OOBase::CrtAllocator::allocate(size_t len, size_t align)
 {
 	if (!len)
 		return NULL;
-	else
-		return ::HeapAlloc(Win32Thunk::instance().m_hHeap,0,len);
+
+	align = heap_align(align);
+	char* block = static_cast<char*>(::HeapAlloc(Win32Thunk::instance().m_hHeap,0,len + align));
+	if (!block)
+		return NULL;
+
+	return heap_place(block,align);
 }
 
-void* OOBase::CrtAllocator::reallocate(void* ptr, size_t len, size_t /*align*/)
+void* OOBase::CrtAllocator::reallocate(void* ptr, size_t len, size_t align)
 {
 	if (!len)
 		return NULL;
 	else if (!ptr)
-		return ::HeapAlloc(Win32Thunk::instance().m_hHeap,0,len);
-	else
-		return ::HeapReAlloc(Win32Thunk::instance().m_hHeap,0,ptr,len);
+		return allocate(len,align);
+
+	HANDLE hHeap = Win32Thunk::instance().m_hHeap;
+	char* block = heap_block(ptr);
+	size_t offset = static_cast<char*>(ptr) - block;
+
+	align = heap_align(align);
+	if (!(reinterpret_cast<size_t>(ptr) & (align-1)))
+	{
+		if (::HeapReAlloc(hHeap,HEAP_REALLOC_IN_PLACE_ONLY,block,len + offset))
+			return ptr;
+
+		// A heap-aligned block keeps its offset wherever HeapReAlloc() moves it
+		if (align == MEMORY_ALLOCATION_ALIGNMENT && offset == MEMORY_ALLOCATION_ALIGNMENT)
+		{
+			block = static_cast<char*>(::HeapReAlloc(hHeap,0,block,len + offset));
+			if (!block)
+				return NULL;
+
+			return heap_place(block,align);
+		}
+	}
+
+	// Move the block to somewhere suitably aligned
+	size_t old_len = ::HeapSize(hHeap,0,block) - offset;
+	void* new_ptr = allocate(len,align);
+	if (new_ptr)
+	{
+		memcpy(new_ptr,ptr,old_len < len ? old_len : len);
+		free(ptr);
+	}
+	return new_ptr;
 }
 
 void OOBase::CrtAllocator::free(void* ptr)
 {
 	if (ptr)
-		::HeapFree(Win32Thunk::instance().m_hHeap,0,ptr);
+		::HeapFree(Win32Thunk::instance().m_hHeap,0,heap_block(ptr));
 }
 
 #endif
 
+bool OOBase::CrtAllocator::get_stats(AllocatorStats& /*stats*/)
+{
+	// The process heap is not instrumented, wrap it in a CountingAllocator instead
+	return false;
+}
+
 #endif // _WIN32